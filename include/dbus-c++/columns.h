@@ -0,0 +1,184 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef __DBUSXX_COLUMNS_H
+#define __DBUSXX_COLUMNS_H
+
+#include "api.h"
+#include "types.h"
+
+namespace DBus
+{
+
+/*
+ *   Columnar marshalling of arrays of structs
+ *
+ *   std::vector<int32_t> ids;
+ *   std::vector<double> x, y, z;
+ *
+ *   wi << DBus::columns(ids, x, y, z);  // writes a(iddd), row i is (ids[i], x[i], y[i], z[i])
+ *   ri >> DBus::columns(ids, x, y, z);  // appends each member of a(iddd) to its column
+ *
+ * The rows are streamed straight from and into the parallel vectors, there
+ * is no intermediate std::vector< Struct<...> >. All columns must have the
+ * same length when writing.
+ */
+template <typename... T>
+class Columns
+{
+public:
+
+  Columns(std::vector<T>&... cols)
+    : _cols(cols...)
+  {}
+
+  size_t rows() const
+  {
+    return std::get<0>(_cols).size();
+  }
+
+  std::tuple<std::vector<T>&...> &cols() const
+  {
+    return _cols;
+  }
+
+private:
+
+  mutable std::tuple<std::vector<T>&...> _cols;
+};
+
+template <typename... T>
+inline Columns<T...> columns(std::vector<T>&... cols)
+{
+  return Columns<T...>(cols...);
+}
+
+template <typename... T>
+struct type< Columns<T...> >
+  : sig_join< sig_string<'a', '('>, type<T>..., sig_string<')'> >
+{};
+
+/* per-column operations, I is the next column
+ */
+template <size_t I, size_t N>
+struct column_members
+{
+  template <typename Cols>
+  static bool same_rows(const Cols &cols, size_t rows)
+  {
+    return std::get<I>(cols).size() == rows && column_members<I + 1, N>::same_rows(cols, rows);
+  }
+
+  template <typename Cols>
+  static void append(MessageIter &iter, const Cols &cols, size_t row)
+  {
+    iter << std::get<I>(cols)[row];
+    column_members<I + 1, N>::append(iter, cols, row);
+  }
+
+  template <typename Cols>
+  static void get(MessageIter &iter, Cols &cols)
+  {
+    typedef typename std::remove_reference<typename std::tuple_element<I, Cols>::type>::type column;
+
+    typename column::value_type value;
+
+    iter >> value;
+    std::get<I>(cols).push_back(std::move(value));
+    column_members<I + 1, N>::get(iter, cols);
+  }
+};
+
+template <size_t N>
+struct column_members<N, N>
+{
+  template <typename Cols>
+  static bool same_rows(const Cols &, size_t)
+  {
+    return true;
+  }
+
+  template <typename Cols>
+  static void append(MessageIter &, const Cols &, size_t)
+  {}
+
+  template <typename Cols>
+  static void get(MessageIter &, Cols &)
+  {}
+};
+
+template <typename... T>
+inline MessageIter &operator << (MessageIter &iter, const Columns<T...>& val)
+{
+  typedef column_members<0, sizeof...(T)> members;
+
+  const size_t rows = val.rows();
+
+  if (!members::same_rows(val.cols(), rows))
+    throw ErrorInvalidArgs("column length mismatch");
+
+  const sig_cstr< sig_join< sig_string<'('>, type<T>..., sig_string<')'> > > sig;
+  MessageIter ait = iter.new_array(sig.c_str());
+
+  for (size_t row = 0; row < rows; ++row)
+  {
+    MessageIter sit = ait.new_struct();
+
+    members::append(sit, val.cols(), row);
+
+    ait.close_container(sit);
+  }
+
+  iter.close_container(ait);
+  return iter;
+}
+
+template <typename... T>
+inline MessageIter &operator >> (MessageIter &iter, const Columns<T...>& val)
+{
+  typedef column_members<0, sizeof...(T)> members;
+
+  if (!iter.is_array())
+    throw ErrorInvalidArgs("array expected");
+
+  /* the rows are structs, counting them up front would walk the whole
+   * array once more, so the columns grow as they are read
+   */
+  MessageIter ait = iter.recurse();
+
+  while (!ait.at_end())
+  {
+    MessageIter sit = ait.recurse();
+
+    members::get(sit, val.cols());
+
+    ++ait;
+  }
+
+  return ++iter;
+}
+
+} /* namespace DBus */
+
+#endif//__DBUSXX_COLUMNS_H
@@ -26,6 +26,7 @@
 #define __DBUSXX_CONNECTION_H
 
 #include <list>
+#include <vector>
 
 #include "api.h"
 #include "types.h"
@@ -40,6 +41,8 @@ class Connection;
 
 typedef Slot<bool, const Message &> MessageSlot;
 
+typedef Slot<void, bool> WatermarkSlot;
+
 typedef std::list<Connection>	ConnectionList;
 
 class ObjectAdaptor;
@@ -49,12 +52,36 @@ class DXXAPI Connection
 {
 public:
 
+  /*!
+   * \brief Selects the code that moves messages between the process and the bus.
+   *
+   * Libdbus uses libdbus's own connection layer. Native speaks the protocol
+   * directly over unix: addresses: it authenticates with SASL EXTERNAL,
+   * writes each message as soon as it is sent unless corked (see
+   * set_cork()) and reads incoming frames in batches, handing each frame to
+   * its message as the buffer Message::wire_reader() decodes in place. It skips libdbus's locking
+   * and internal copies, but has no send_async(), cannot pass unix fds
+   * and ignores exit_on_disconnect(). Native connections are always
+   * private.
+   */
+  enum Transport
+  {
+    Libdbus,
+    Native
+  };
+
   static Connection SystemBus();
 
+  static Connection SystemBus(Transport transport);
+
   static Connection SessionBus();
 
+  static Connection SessionBus(Transport transport);
+
   static Connection ActivationBus();
 
+  static Connection ActivationBus(Transport transport);
+
   struct Private;
 
   typedef std::list<Private *> PrivatePList;
@@ -63,6 +90,8 @@ public:
 
   Connection(const char *address, bool priv = true);
 
+  Connection(const char *address, bool priv, Transport transport);
+
   Connection(const Connection &c);
 
   virtual ~Connection();
@@ -355,6 +384,103 @@ public:
    */
   bool send(const Message &msg, unsigned int *serial = NULL);
 
+  /*!
+   * \brief Corks a native connection, or uncorks it with a budget of 0.
+   *
+   * A corked connection holds back what send() queues until budget_us
+   * microseconds have passed since the oldest waiting message or bytes
+   * are waiting, then writes them together from the dispatcher: the budget
+   * is honoured to the granularity of its timeouts, a millisecond with
+   * BusDispatcher. send_blocking(), send_batch() and flush() write out
+   * everything corked before their own messages.
+   *
+   * \param budget_us The longest a message may be held back.
+   * \param bytes The amount of held back data that is written at once.
+   * \return false On libdbus connections, which write as libdbus sees fit.
+   */
+  bool set_cork(unsigned int budget_us, size_t bytes = 65536);
+
+  /*!
+   * \brief Gives outgoing replies and errors, method calls and signals a
+   *        queue each on a native connection.
+   *
+   * Queued messages are written replies first and signals last, each
+   * queue in order, so that a reply does not wait behind a burst of
+   * signals sent before it; a queue that has let 16 messages pass goes
+   * next. The socket's send buffer shrinks meanwhile, so that the backlog
+   * waits in the queues rather than in the kernel. Messages of different
+   * kinds may thus reach the peer in another order than they were sent.
+   *
+   * \return false On libdbus connections, which keep a single queue.
+   */
+  bool set_priority_lanes(bool on);
+
+  /*!
+   * \brief Sends several messages in order, as with send(), then flushes once.
+   *
+   * Native connections marshal the whole batch first and write it with as
+   * few writev() calls as the socket allows. Libdbus writes each message
+   * separately but leaves the flush to the end of the batch.
+   *
+   * \param messages The Messages to write.
+   * \return The serial of each message, 0 for those that could not be sent.
+   */
+  std::vector<unsigned int> send_batch(const std::vector<Message> &messages);
+
+  /*!
+   * \brief Queues a message as send() does, unless the outgoing queue is above
+   *        its high watermark.
+   *
+   * Never blocks, like send().
+   *
+   * \param msg The Message to write.
+   * \param serial Return location for message serial, or NULL if you don't care.
+   * \return false If the queue is above the watermark or on lack of memory.
+   */
+  bool try_send(const Message &msg, unsigned int *serial = NULL);
+
+  /*!
+   * \brief Bytes of outgoing messages not yet written to the socket.
+   */
+  long outgoing_size();
+
+  /*!
+   * \brief Unix fds attached to outgoing messages not yet written, always 0
+   *        on native connections, which cannot pass them.
+   */
+  long outgoing_unix_fds();
+
+  /*!
+   * \brief Outgoing messages not yet completely written, or -1 on libdbus
+   *        connections, which do not count them.
+   */
+  long outgoing_messages();
+
+  /*!
+   * \brief Watches the size of the outgoing queue.
+   *
+   * The slot returned by watermark() is called with true once the queue
+   * reaches high_size bytes or high_messages messages, and with false once
+   * it is back to low_size bytes and low_messages messages; a high mark of
+   * 0 is not watched. Calls happen in whatever thread sends, or dispatches
+   * while the queue drains. Libdbus writes a backlog from the dispatcher
+   * without saying when, so above the high mark its queue is looked at
+   * every 10 milliseconds; try_send() always looks first.
+   *
+   * \return false If a high message mark is given on a libdbus connection,
+   *         which does not count messages (see outgoing_messages()); the
+   *         marks are left as they were.
+   */
+  bool set_watermarks(long high_size, long low_size, long high_messages = 0, long low_messages = 0);
+
+  WatermarkSlot &watermark();
+
+  /*!
+   * \brief Whether the outgoing queue reached a high watermark and is not
+   *        back to the low one yet, in which case try_send() refuses.
+   */
+  bool above_watermark();
+
   /*!
    * \brief Sends a message and blocks a certain time period while waiting for a reply.
    *
@@ -452,6 +578,25 @@ public:
 
   int get_timeout();
 
+  /*!
+   * \brief Sets the largest incoming message accepted; a peer sending a
+   *        larger one is disconnected.
+   */
+  void set_max_message_size(long size);
+
+  long get_max_message_size();
+
+  /*!
+   * \brief Sets how many bytes of incoming messages may wait to be
+   *        dispatched before the connection stops reading from the socket.
+   *
+   * Libdbus counts messages until they are freed, the native transport until
+   * they are dispatched, and it keeps reading replies to send_blocking().
+   */
+  void set_max_received_size(long size);
+
+  long get_max_received_size();
+
 private:
 
   DXXAPILOCAL void init();
@@ -26,6 +26,10 @@
 #define __DBUSXX_DBUS_H
 
 #include "types.h"
+#include "struct.h"
+#include "columns.h"
+#include "wire.h"
+#include "dynamic.h"
 #include "interface.h"
 #include "object.h"
 #include "property.h"
@@ -0,0 +1,208 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef __DBUSXX_DYNAMIC_H
+#define __DBUSXX_DYNAMIC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "api.h"
+#include "message.h"
+#include "wire.h"
+
+namespace DBus
+{
+
+/* Bump allocator holding DynamicValue trees: whatever was decoded into it
+ * is released at once by clear() or when the arena goes away.
+ */
+class DXXAPI ValueArena
+{
+public:
+
+  ValueArena(size_t block_size = 16384);
+
+  ~ValueArena();
+
+  void *allocate(size_t size, size_t align = 8);
+
+  /* frees everything but the newest block, which is reused
+   */
+  void clear();
+
+private:
+
+  ValueArena(const ValueArena &);
+
+  ValueArena &operator = (const ValueArena &);
+
+  struct Block;
+
+  Block *_blocks;
+  char *_next;
+  char *_end;
+  size_t _block_size;
+};
+
+/* One node of a dynamically typed value, as decoded and encoded by
+ * SignaturePlan. type is the code MessageIter::type() would report.
+ *
+ * Basic values live in the union. Strings, object paths and signatures are
+ * NUL-terminated, size bytes long. Structs and dict entries have size
+ * members in items, arrays size elements: in items, or packed in data when
+ * the elements are fixed-size (y, b, n, q, i, u, x, t, d; booleans 32 bit
+ * wide). A variant has its contents in items[0] and their type in
+ * signature.
+ */
+struct DXXAPI DynamicValue
+{
+  char type;
+  uint32_t size;
+  const char *signature;
+
+  union
+  {
+    uint8_t y;
+    bool b;
+    int16_t n;
+    uint16_t q;
+    int32_t i;
+    uint32_t u;
+    int64_t x;
+    uint64_t t;
+    double d;
+    int h;
+    const char *str;
+    const void *data;
+    DynamicValue *items;
+  };
+};
+
+/*
+ *   Signature compiler
+ *
+ * Turns a D-Bus signature into a flat list of steps once, so that code
+ * which only learns its types at run time (bridges, introspection-driven
+ * tools) can move whole message bodies in and out of DynamicValue trees
+ * without parsing signatures or asking libdbus for types along the way:
+ *
+ *   std::unique_ptr<DBus::SignaturePlan> once;
+ *   const DBus::SignaturePlan &plan = DBus::SignaturePlan::get(msg.signature(), once);
+ *   DBus::ValueArena arena;
+ *   DBus::DynamicValue *args = plan.decode(msg, arena);
+ *   ...
+ *   DBus::WireWriter w;
+ *   plan.encode(args, w);
+ *
+ * Plans are cached per signature and live as long as the process. Only a
+ * bounded number of them are kept, since the peer picks the signatures;
+ * beyond that a plan is compiled for each use and held by once.
+ */
+class DXXAPI SignaturePlan
+{
+public:
+
+  /* the plan for signature, compiled on first use; held by once if the
+   * cache is full, so it lives as long as once then. Throws
+   * ErrorInvalidArgs if it is not a valid signature
+   */
+  static const SignaturePlan &get(const char *signature, std::unique_ptr<SignaturePlan> &once);
+
+  const std::string &signature() const
+  {
+    return _signature;
+  }
+
+  /* number of complete types in the signature, i.e. of top level values
+   */
+  size_t count() const
+  {
+    return _count;
+  }
+
+  /* the count() values of the body of msg, which must have this signature,
+   * read straight from the marshalled body where possible
+   */
+  DynamicValue *decode(const Message &msg, ValueArena &arena) const;
+
+  /* the count() values starting at it, which is moved past them
+   */
+  DynamicValue *decode(MessageIter &it, ValueArena &arena) const;
+
+  /* appends count() values, throwing ErrorInvalidArgs if they do not match
+   * the signature; WireWriter cannot carry unix fds
+   */
+  void encode(const DynamicValue *values, WireWriter &w) const;
+
+  void encode(const DynamicValue *values, MessageIter &it) const;
+
+private:
+
+  SignaturePlan(const char *signature);
+
+  SignaturePlan(const SignaturePlan &);
+
+  SignaturePlan &operator = (const SignaturePlan &);
+
+  /* one per type in the signature, in order; the steps of a container's
+   * contents follow it, up to next
+   */
+  struct Step
+  {
+    char type;
+    uint8_t align;
+    uint8_t size;     // fixed-size types only
+    uint32_t next;
+    uint32_t members; // structs and dict entries
+    uint32_t sig;     // offset of the NUL-terminated signature in _sigs
+  };
+
+  DXXAPILOCAL uint32_t compile(const char *&sig);
+
+  /* the cached plan for signature, compiled and cached on first use; 0
+   * once the plans for top level signatures, or for variant contents, fill
+   * their share of the cache
+   */
+  DXXAPILOCAL static const SignaturePlan *lookup(const char *signature, bool variant);
+
+  /* the plan for the contents of a variant, held by once if uncached
+   */
+  DXXAPILOCAL static const SignaturePlan &variant(const char *signature, std::unique_ptr<SignaturePlan> &once);
+
+  struct Decoder;
+  struct Encoder;
+
+  std::string _signature;
+  std::vector<Step> _steps;
+  std::string _sigs;
+  size_t _count;
+};
+
+} /* namespace DBus */
+
+#endif//__DBUSXX_DYNAMIC_H
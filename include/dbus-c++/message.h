@@ -40,12 +40,13 @@ class SignalMessage;
 class ReturnMessage;
 class Error;
 class Connection;
+class Variant;
 
 class DXXAPI MessageIter
 {
 public:
 
-  MessageIter() {}
+  MessageIter() : _checked(true), _validate(false), _wire(0) {}
 
   int type();
 
@@ -119,6 +120,10 @@ public:
 
   bool is_dict();
 
+  /* number of elements in the array this iterator points to
+   */
+  int element_count();
+
   MessageIter new_array(const char *sig);
 
   MessageIter new_variant(const char *sig);
@@ -131,6 +136,42 @@ public:
 
   void copy_data(MessageIter &to);
 
+  /*!
+   * \brief Trusted-input mode for readers, inherited by the containers
+   *        opened from this iterator.
+   *
+   * Trusted readers do not type-check basic values, as with
+   * Message::unchecked_reader().
+   */
+  void trusted(bool t)
+  {
+    _checked = !t;
+  }
+
+  bool trusted() const
+  {
+    return !_checked;
+  }
+
+  /*!
+   * \brief Validating mode for writers, inherited by the containers
+   *        opened from this iterator.
+   *
+   * libdbus checks every string, object path and signature appended and
+   * aborts the process on invalid input. Validating writers check them
+   * first and throw ErrorInvalidArgs instead, at the cost of a second
+   * pass over each value.
+   */
+  void validating(bool v)
+  {
+    _validate = v;
+  }
+
+  bool validating() const
+  {
+    return _validate;
+  }
+
   Message &msg() const
   {
     return *_msg;
@@ -138,12 +179,14 @@ public:
 
 private:
 
-  DXXAPILOCAL MessageIter(Message &msg) : _msg(&msg) {}
+  DXXAPILOCAL MessageIter(Message &msg) : _msg(&msg), _checked(true), _validate(false), _wire(0) {}
 
   DXXAPILOCAL bool append_basic(int type_id, void *value);
 
   DXXAPILOCAL void get_basic(int type_id, void *ptr);
 
+  DXXAPILOCAL int wire_type() const;
+
 private:
 
   /* I'm sorry, but don't want to include dbus.h in the public api
@@ -152,7 +195,27 @@ private:
 
   Message *_msg;
 
+  /* false in trusted-input mode, see trusted()
+   */
+  bool _checked;
+
+  /* see validating()
+   */
+  bool _validate;
+
+  /* cursor into the marshalled body when reading in place, see
+   * Message::wire_reader(); _iter is unused while _wire is set
+   */
+  const unsigned char *_wire;
+  const char *_wsig;      // current type in the signature
+  const char *_welem;     // element signature of the enclosing array, or 0
+  size_t _wpos;           // offset of the current value
+  size_t _wend;           // end of the enclosing array or body
+
   friend class Message;
+  friend class Variant;
+  friend class WireWriter;
+  friend class SignaturePlan;
 };
 
 class DXXAPI Message
@@ -165,12 +228,26 @@ public:
 
   Message(const Message &m);
 
+  /*!
+   * \brief Takes over the reference held by \a m without touching the
+   *        libdbus refcount; \a m may only be destroyed or assigned to.
+   */
+  Message(Message &&m);
+
   ~Message();
 
   Message &operator = (const Message &m);
 
+  Message &operator = (Message &&m);
+
   Message copy();
 
+  /*!
+   * \brief Loads a message from its wire representation, in either byte
+   *        order; throws Error if the data is not a valid message.
+   */
+  static Message demarshal(const char *data, size_t size);
+
   int type() const;
 
   int serial() const;
@@ -193,6 +270,32 @@ public:
 
   MessageIter reader() const;
 
+  /*!
+   * \brief Reader for a message whose body must match \a signature.
+   *
+   * The whole signature is compared once, throwing ErrorInvalidArgs on
+   * mismatch; the returned iterator then reads basic values without
+   * checking each of them. The contents of variants are still checked.
+   * Bodies holding arrays of variable-size elements are read in place
+   * (see wire_reader()) if the message holds its marshalled form already,
+   * as those received on native connections do, or if the arrays take 64
+   * bytes or more; below that the copy costs more than it saves.
+   */
+  MessageIter unchecked_reader(const char *signature) const;
+
+  /*!
+   * \brief Reader that decodes the body in place.
+   *
+   * The body is marshalled once into a buffer owned by the message (and
+   * converted to host byte order if needed); the returned iterator then
+   * walks that buffer with plain loads, and strings and fixed arrays
+   * point into it. Falls back to reader() for bodies carrying unix fds
+   * or when the buffer cannot be allocated. The buffer lives as long as
+   * the message, or until writer() or append() drop it; readers in several
+   * threads may share it.
+   */
+  MessageIter wire_reader() const;
+
   MessageIter writer();
 
   bool append(int first_type, ...);
@@ -214,6 +317,8 @@ protected:
   friend class MessageIter;
   friend class Error;
   friend class Connection;
+  friend class WireWriter;
+  friend class SignaturePlan;
 };
 
 /*
@@ -52,9 +52,7 @@ public:
 
   PropertyAdaptor &operator = (const T &t)
   {
-    _data->value.clear();
-    MessageIter wi = _data->value.writer();
-    wi << t;
+    _data->value = Variant(t);
     return *this;
   }
 
@@ -0,0 +1,104 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef __DBUSXX_STRUCT_H
+#define __DBUSXX_STRUCT_H
+
+#include "api.h"
+#include "types.h"
+#include "wire.h"
+
+/*
+ *   Marshalling for user-defined structs
+ *
+ *   struct Point { int32_t x; int32_t y; std::string label; };
+ *
+ *   DBUSXX_STRUCT(Point, x, y, label)
+ *
+ * declares DBus::type<Point> (signature "(iis)") and the operator<< and
+ * operator>> of Point, which read and write the listed members in place,
+ * in the given order (operator<< also for WireWriter). Use it at global
+ * scope, with the fully qualified type name, for up to 16 members.
+ */
+
+#define DBUSXX_CAT_(a, b) a ## b
+#define DBUSXX_CAT(a, b) DBUSXX_CAT_(a, b)
+
+#define DBUSXX_NARG_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
+#define DBUSXX_NARG(...) DBUSXX_NARG_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)
+
+/* applies M(T, field) to each field */
+#define DBUSXX_EACH_1(M, T, f) M(T, f)
+#define DBUSXX_EACH_2(M, T, f, ...) M(T, f) DBUSXX_EACH_1(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_3(M, T, f, ...) M(T, f) DBUSXX_EACH_2(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_4(M, T, f, ...) M(T, f) DBUSXX_EACH_3(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_5(M, T, f, ...) M(T, f) DBUSXX_EACH_4(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_6(M, T, f, ...) M(T, f) DBUSXX_EACH_5(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_7(M, T, f, ...) M(T, f) DBUSXX_EACH_6(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_8(M, T, f, ...) M(T, f) DBUSXX_EACH_7(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_9(M, T, f, ...) M(T, f) DBUSXX_EACH_8(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_10(M, T, f, ...) M(T, f) DBUSXX_EACH_9(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_11(M, T, f, ...) M(T, f) DBUSXX_EACH_10(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_12(M, T, f, ...) M(T, f) DBUSXX_EACH_11(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_13(M, T, f, ...) M(T, f) DBUSXX_EACH_12(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_14(M, T, f, ...) M(T, f) DBUSXX_EACH_13(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_15(M, T, f, ...) M(T, f) DBUSXX_EACH_14(M, T, __VA_ARGS__)
+#define DBUSXX_EACH_16(M, T, f, ...) M(T, f) DBUSXX_EACH_15(M, T, __VA_ARGS__)
+#define DBUSXX_EACH(M, T, ...) DBUSXX_CAT(DBUSXX_EACH_, DBUSXX_NARG(__VA_ARGS__))(M, T, __VA_ARGS__)
+
+#define DBUSXX_STRUCT_SIG(T, f) , ::DBus::type< decltype(T::f) >
+#define DBUSXX_STRUCT_APPEND(T, f) sit << val.f;
+#define DBUSXX_STRUCT_GET(T, f) sit >> val.f;
+#define DBUSXX_STRUCT_WIRE(T, f) w << val.f;
+
+#define DBUSXX_STRUCT(T, ...) \
+namespace DBus \
+{ \
+template <> struct type< T > \
+  : sig_join< sig_string<'('> DBUSXX_EACH(DBUSXX_STRUCT_SIG, T, __VA_ARGS__), sig_string<')'> > \
+{}; \
+inline MessageIter &operator << (MessageIter &iter, const T &val) \
+{ \
+  MessageIter sit = iter.new_struct(); \
+  DBUSXX_EACH(DBUSXX_STRUCT_APPEND, T, __VA_ARGS__) \
+  iter.close_container(sit); \
+  return iter; \
+} \
+inline MessageIter &operator >> (MessageIter &iter, T &val) \
+{ \
+  MessageIter sit = iter.recurse(); \
+  DBUSXX_EACH(DBUSXX_STRUCT_GET, T, __VA_ARGS__) \
+  return ++iter; \
+} \
+inline WireWriter &operator << (WireWriter &w, const T &val) \
+{ \
+  const sig_cstr< type< T > > sig; \
+  w.open_struct(sig.c_str()); \
+  DBUSXX_EACH(DBUSXX_STRUCT_WIRE, T, __VA_ARGS__) \
+  w.close_struct(); \
+  return w; \
+} \
+}
+
+#endif//__DBUSXX_STRUCT_H
@@ -26,9 +26,30 @@
 #define __DBUSXX_TYPES_H
 
 #include <stdint.h>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <set>
+#include <deque>
+#include <list>
+#include <array>
+#include <bitset>
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+
+/* std::pmr overloads, when the including code is built as C++17
+ */
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define DBUSXX_HAS_PMR 1
+#endif
+#endif
 
 #include "api.h"
 #include "util.h"
@@ -42,6 +63,7 @@ struct DXXAPI Path : public std::string
 {
   Path() {}
   Path(const std::string &s) : std::string(s) {}
+  Path(std::string &&s) : std::string(std::move(s)) {}
   Path(const char *c) : std::string(c) {}
   Path &operator = (std::string &s)
   {
@@ -54,6 +76,7 @@ struct DXXAPI Signature : public std::string
 {
   Signature() {}
   Signature(const std::string &s) : std::string(s) {}
+  Signature(std::string &&s) : std::string(std::move(s)) {}
   Signature(const char *c) : std::string(c) {}
   Signature &operator = (std::string &s)
   {
@@ -64,6 +87,170 @@ struct DXXAPI Signature : public std::string
 
 struct DXXAPI Invalid {};
 
+/* Read-only view on a string stored inside a message.
+ *
+ * The characters are borrowed, not copied: the view is only valid as long as
+ * the Message it was read from is alive. The referenced characters are always
+ * NUL-terminated, so c_str() can be handed back to libdbus.
+ */
+class DXXAPI StringView
+{
+public:
+
+  typedef const char *const_iterator;
+
+  StringView() : _data(""), _size(0)
+  {}
+
+  StringView(const char *c) : _data(c), _size(strlen(c))
+  {}
+
+  StringView(const std::string &s) : _data(s.c_str()), _size(s.size())
+  {}
+
+  const char *data() const
+  {
+    return _data;
+  }
+
+  const char *c_str() const
+  {
+    return _data;
+  }
+
+  size_t size() const
+  {
+    return _size;
+  }
+
+  size_t length() const
+  {
+    return _size;
+  }
+
+  bool empty() const
+  {
+    return _size == 0;
+  }
+
+  const_iterator begin() const
+  {
+    return _data;
+  }
+
+  const_iterator end() const
+  {
+    return _data + _size;
+  }
+
+  char operator[](size_t i) const
+  {
+    return _data[i];
+  }
+
+  std::string str() const
+  {
+    return std::string(_data, _size);
+  }
+
+  operator std::string() const
+  {
+    return str();
+  }
+
+private:
+
+  const char *_data;
+  size_t _size;
+};
+
+inline bool operator == (const StringView &a, const StringView &b)
+{
+  return a.size() == b.size() && memcmp(a.data(), b.data(), a.size()) == 0;
+}
+
+inline bool operator != (const StringView &a, const StringView &b)
+{
+  return !(a == b);
+}
+
+inline bool operator < (const StringView &a, const StringView &b)
+{
+  int r = memcmp(a.data(), b.data(), a.size() < b.size() ? a.size() : b.size());
+  return r < 0 || (r == 0 && a.size() < b.size());
+}
+
+/* Read-only view on an array of a fixed-size type (y, n, q, i, u, x, t, d)
+ * stored inside a message, with the same lifetime rules as StringView.
+ */
+template <typename T>
+class ArrayView
+{
+public:
+
+  typedef T value_type;
+  typedef const T *const_iterator;
+
+  ArrayView() : _data(0), _size(0)
+  {}
+
+  ArrayView(const T *data, size_t size) : _data(data), _size(size)
+  {}
+
+  ArrayView(const std::vector<T> &v) : _data(v.data()), _size(v.size())
+  {}
+
+  const T *data() const
+  {
+    return _data;
+  }
+
+  size_t size() const
+  {
+    return _size;
+  }
+
+  bool empty() const
+  {
+    return _size == 0;
+  }
+
+  const_iterator begin() const
+  {
+    return _data;
+  }
+
+  const_iterator end() const
+  {
+    return _data + _size;
+  }
+
+  const T &operator[](size_t i) const
+  {
+    return _data[i];
+  }
+
+  std::vector<T> to_vector() const
+  {
+    return std::vector<T>(begin(), end());
+  }
+
+private:
+
+  const T *_data;
+  size_t _size;
+};
+
+/* A Variant keeps basic values and short strings inline; only containers
+ * and long strings are stored in a (dummy) message, which is also created
+ * on demand whenever reader() or writer() is used.
+ *
+ * Containers read from a received (or already sent, hence immutable) message
+ * are not copied at all: the variant keeps a reference to that message and
+ * the position of its value, and copies it only when writer() is called or
+ * detach() is asked to release the source message. Values read through
+ * Message::wire_reader() are copied right away.
+ */
 class DXXAPI Variant
 {
 public:
@@ -72,30 +259,264 @@ public:
 
   Variant(MessageIter &it);
 
+  Variant(const Variant &v);
+
+  Variant(Variant &&v);
+
+  template <typename T>
+  explicit Variant(const T &value);
+
+  ~Variant();
+
   Variant &operator = (const Variant &v);
 
+  Variant &operator = (Variant &&v);
+
   const Signature signature() const;
 
   void clear();
 
-  MessageIter reader() const
+  MessageIter reader() const;
+
+  MessageIter writer();
+
+  /* copy a value still referencing its source message into storage of its own
+   */
+  void detach();
+
+  template <typename T>
+  operator T() const;
+
+#ifdef DBUSXX_HAS_PMR
+  /* the value as T, where an allocator-aware T (and everything nested in
+   * it) takes its memory from mr instead of the default resource
+   */
+  template <typename T>
+  T get(std::pmr::memory_resource *mr) const;
+#endif
+
+private:
+
+  struct Slice;
+
+  DXXAPILOCAL Message &msg() const;
+
+  DXXAPILOCAL void read_from(MessageIter &vi);
+
+  DXXAPILOCAL void append_inline(MessageIter &it) const;
+
+  DXXAPILOCAL bool set_inline_string(char type, const char *chars);
+
+  template <typename T>
+  void assign(const T &value)
+  {
+    MessageIter wi = writer();
+    wi << value;
+  }
+
+  void assign(const uint8_t &value)
+  {
+    _type = 'y';
+    _data.y = value;
+  }
+
+  void assign(const bool &value)
+  {
+    _type = 'b';
+    _data.b = value;
+  }
+
+  void assign(const int16_t &value)
+  {
+    _type = 'n';
+    _data.n = value;
+  }
+
+  void assign(const uint16_t &value)
+  {
+    _type = 'q';
+    _data.q = value;
+  }
+
+  void assign(const int32_t &value)
+  {
+    _type = 'i';
+    _data.i = value;
+  }
+
+  void assign(const uint32_t &value)
+  {
+    _type = 'u';
+    _data.u = value;
+  }
+
+  void assign(const int64_t &value)
   {
-    return _msg.reader();
+    _type = 'x';
+    _data.x = value;
   }
 
-  MessageIter writer()
+  void assign(const uint64_t &value)
   {
-    return _msg.writer();
+    _type = 't';
+    _data.t = value;
   }
 
+  void assign(const double &value)
+  {
+    _type = 'd';
+    _data.d = value;
+  }
+
+  void assign(const std::string &value);
+
+  void assign(const Path &value);
+
+  void assign(const Signature &value);
+
   template <typename T>
-  operator T() const;
+  bool get_inline(T &) const
+  {
+    return false;
+  }
+
+  bool get_inline(uint8_t &value) const
+  {
+    if (_type != 'y') return false;
+    value = _data.y;
+    return true;
+  }
+
+  bool get_inline(bool &value) const
+  {
+    if (_type != 'b') return false;
+    value = _data.b;
+    return true;
+  }
+
+  bool get_inline(int16_t &value) const
+  {
+    if (_type != 'n') return false;
+    value = _data.n;
+    return true;
+  }
+
+  bool get_inline(uint16_t &value) const
+  {
+    if (_type != 'q') return false;
+    value = _data.q;
+    return true;
+  }
+
+  bool get_inline(int32_t &value) const
+  {
+    if (_type != 'i') return false;
+    value = _data.i;
+    return true;
+  }
+
+  bool get_inline(uint32_t &value) const
+  {
+    if (_type != 'u') return false;
+    value = _data.u;
+    return true;
+  }
+
+  bool get_inline(int64_t &value) const
+  {
+    if (_type != 'x') return false;
+    value = _data.x;
+    return true;
+  }
+
+  bool get_inline(uint64_t &value) const
+  {
+    if (_type != 't') return false;
+    value = _data.t;
+    return true;
+  }
+
+  bool get_inline(double &value) const
+  {
+    if (_type != 'd') return false;
+    value = _data.d;
+    return true;
+  }
+
+  bool get_inline(std::string &value) const
+  {
+    if (_type != 's') return false;
+    value = _data.s;
+    return true;
+  }
+
+  bool get_inline(Path &value) const
+  {
+    if (_type != 'o') return false;
+    value = Path(_data.s);
+    return true;
+  }
+
+  bool get_inline(Signature &value) const
+  {
+    if (_type != 'g') return false;
+    value = Signature(_data.s);
+    return true;
+  }
+
+#ifdef DBUSXX_HAS_PMR
+  bool get_inline(std::pmr::string &value) const
+  {
+    if (_type != 's') return false;
+    value.assign(_data.s);
+    return true;
+  }
+#endif
 
 private:
 
-  Message _msg;
+  /* longest string (including the terminating NUL) kept inline
+   */
+  static const size_t inline_size = 24;
+
+  /* type code of the inline value, 0 if there is none
+   */
+  char _type;
+
+  union
+  {
+    uint8_t y;
+    bool b;
+    int16_t n;
+    uint16_t q;
+    int32_t i;
+    uint32_t u;
+    int64_t x;
+    uint64_t t;
+    double d;
+    char s[inline_size];
+  } _data;
+
+  /* dummy message used as storage for non-inline variant data, created by
+   * the first reader() of an inline value; only ever set once while const
+   */
+  mutable Message *_msg;
+
+  /* value borrowed from the message it was read from
+   */
+  Slice *_slice;
+
+  friend DXXAPI MessageIter &operator << (MessageIter &iter, const Variant &val);
+  friend DXXAPI MessageIter &operator >> (MessageIter &iter, Variant &val);
+  friend class WireWriter;
 };
 
+/* Fixed-arity D-Bus structure, kept for source compatibility.
+ *
+ * Unused slots are Invalid members which still take space and are streamed
+ * through no-op operators; std::tuple<T...> maps to the same D-Bus struct
+ * with exactly the listed members and is what dbusxx-xml2cpp generates.
+ */
 template <
 typename T1,
          typename T2 = Invalid,
@@ -140,132 +561,242 @@ inline bool dict_has_key(const std::map<K, V>& map, const K &key)
   return map.find(key) != map.end();
 }
 
-template <typename T>
-struct type
+/*
+ * Signatures are built at compile time out of character packs, so that
+ * type<T>::value is a static, NUL-terminated array and marshalling a
+ * container never has to allocate just to describe its element type.
+ */
+
+template <char... C>
+struct sig_string
 {
+  typedef sig_string chars;
+
+  static constexpr char value[sizeof...(C) + 1] = { C..., '\0' };
+
   static std::string sig()
   {
-    throw ErrorInvalidArgs("unknown type");
-    return "";
+    return value;
   }
 };
 
-template <> struct type<Variant>
+template <char... C>
+constexpr char sig_string<C...>::value[sizeof...(C) + 1];
+
+template <typename... S>
+struct sig_concat;
+
+template <>
+struct sig_concat<>
 {
-  static std::string sig()
-  {
-    return "v";
-  }
+  typedef sig_string<> result;
 };
-template <> struct type<uint8_t>
+
+template <char... A>
+struct sig_concat< sig_string<A...> >
 {
-  static std::string sig()
-  {
-    return "y";
-  }
+  typedef sig_string<A...> result;
 };
-template <> struct type<bool>
+
+template <char... A, char... B, typename... S>
+struct sig_concat< sig_string<A...>, sig_string<B...>, S... >
 {
-  static std::string sig()
-  {
-    return "b";
-  }
+  typedef typename sig_concat< sig_string<A..., B...>, S... >::result result;
 };
-template <> struct type<int16_t>
+
+/* true if P carries a compile-time signature (P::chars), false for
+ * user specialisations of type<> that only provide a runtime sig()
+ */
+template <typename P>
+struct has_static_sig
 {
-  static std::string sig()
-  {
-    return "n";
-  }
+private:
+
+  template <typename U>
+  static char test(typename U::chars *);
+
+  template <typename U>
+  static long test(...);
+
+public:
+
+  static const bool value = sizeof(test<P>(0)) == sizeof(char);
 };
-template <> struct type<uint16_t>
+
+template <typename... P>
+struct all_static_sig;
+
+template <>
+struct all_static_sig<>
 {
-  static std::string sig()
-  {
-    return "q";
-  }
+  static const bool value = true;
 };
-template <> struct type<int32_t>
+
+template <typename P, typename... R>
+struct all_static_sig<P, R...>
 {
-  static std::string sig()
-  {
-    return "i";
-  }
+  static const bool value = has_static_sig<P>::value && all_static_sig<R...>::value;
 };
-template <> struct type<uint32_t>
+
+template <typename... P>
+struct sig_append;
+
+template <>
+struct sig_append<>
 {
-  static std::string sig()
-  {
-    return "u";
-  }
+  static void to(std::string &)
+  {}
 };
-template <> struct type<int64_t>
+
+template <typename P, typename... R>
+struct sig_append<P, R...>
 {
-  static std::string sig()
+  static void to(std::string &s)
   {
-    return "x";
+    s += P::sig();
+    sig_append<R...>::to(s);
   }
 };
-template <> struct type<uint64_t>
+
+template <bool Static, typename... P>
+struct sig_join_impl : sig_concat<typename P::chars...>::result
+{};
+
+template <typename... P>
+struct sig_join_impl<false, P...>
 {
   static std::string sig()
   {
-    return "t";
+    std::string s;
+    sig_append<P...>::to(s);
+    return s;
   }
 };
-template <> struct type<double>
+
+/* joins signature providers (sig_string<> literals or type<> specialisations);
+ * falls back to runtime concatenation only if one of them has no static signature
+ */
+template <typename... P>
+struct sig_join : sig_join_impl<all_static_sig<P...>::value, P...>
+{};
+
+/* the signature of P as a C string, without allocating when P is static
+ */
+template <typename P, bool Static = has_static_sig<P>::value>
+struct sig_cstr
 {
-  static std::string sig()
+  const char *c_str() const
   {
-    return "d";
+    return P::value;
   }
 };
-template <> struct type<std::string>
+
+template <typename P>
+struct sig_cstr<P, false>
 {
-  static std::string sig()
+  sig_cstr() : _sig(P::sig())
+  {}
+
+  const char *c_str() const
   {
-    return "s";
+    return _sig.c_str();
   }
+
+private:
+
+  std::string _sig;
 };
-template <> struct type<Path>
+
+template <typename T>
+struct type
 {
   static std::string sig()
   {
-    return "o";
-  }
-};
-template <> struct type<Signature>
-{
-  static std::string sig()
-  {
-    return "g";
-  }
-};
-template <> struct type<Invalid>
-{
-  static std::string sig()
-  {
-    return "";
+    throw ErrorInvalidArgs("unknown type");
+    return "";
   }
 };
 
-template <typename E>
-struct type< std::vector<E> >
-{
-  static std::string sig()
-  {
-    return "a" + type<E>::sig();
-  }
-};
+template <> struct type<Variant> : sig_string<'v'> {};
+template <> struct type<uint8_t> : sig_string<'y'> {};
+template <> struct type<bool> : sig_string<'b'> {};
+template <> struct type<int16_t> : sig_string<'n'> {};
+template <> struct type<uint16_t> : sig_string<'q'> {};
+template <> struct type<int32_t> : sig_string<'i'> {};
+template <> struct type<uint32_t> : sig_string<'u'> {};
+template <> struct type<int64_t> : sig_string<'x'> {};
+template <> struct type<uint64_t> : sig_string<'t'> {};
+template <> struct type<double> : sig_string<'d'> {};
+template <> struct type<std::string> : sig_string<'s'> {};
+template <> struct type<Path> : sig_string<'o'> {};
+template <> struct type<Signature> : sig_string<'g'> {};
+template <> struct type<Invalid> : sig_string<> {};
+template <> struct type<StringView> : sig_string<'s'> {};
+#ifdef DBUSXX_HAS_PMR
+template <> struct type<std::pmr::string> : sig_string<'s'> {};
+#endif
+
+template <typename T>
+struct type< ArrayView<T> >
+  : sig_join< sig_string<'a'>, type<T> >
+{};
+
+template <typename E, typename A>
+struct type< std::vector<E, A> >
+  : sig_join< sig_string<'a'>, type<E> >
+{};
+
+template <typename K, typename V, typename C, typename A>
+struct type< std::map<K, V, C, A> >
+  : sig_join< sig_string<'a', '{'>, type<K>, type<V>, sig_string<'}'> >
+{};
 
 template <typename K, typename V>
-struct type< std::map<K, V> >
-{
-  static std::string sig()
-  {
-    return "a{" + type<K>::sig() + type<V>::sig() + "}";
-  }
-};
+struct type< std::unordered_map<K, V> >
+  : sig_join< sig_string<'a', '{'>, type<K>, type<V>, sig_string<'}'> >
+{};
+
+template <typename E, size_t N>
+struct type< std::array<E, N> >
+  : sig_join< sig_string<'a'>, type<E> >
+{};
+
+template <typename E>
+struct type< std::set<E> >
+  : sig_join< sig_string<'a'>, type<E> >
+{};
+
+template <typename E>
+struct type< std::deque<E> >
+  : sig_join< sig_string<'a'>, type<E> >
+{};
+
+template <typename E>
+struct type< std::list<E> >
+  : sig_join< sig_string<'a'>, type<E> >
+{};
+
+template <typename A, typename B>
+struct type< std::pair<A, B> >
+  : sig_join< sig_string<'('>, type<A>, type<B>, sig_string<')'> >
+{};
+
+template <size_t N>
+struct type< std::bitset<N> >
+  : sig_string<'a', 'b'>
+{};
+
+/* element types libdbus reads and writes as one block (see append_array())
+ */
+template <typename E> struct is_fixed_element : std::false_type {};
+template <> struct is_fixed_element<uint8_t> : std::true_type {};
+template <> struct is_fixed_element<int16_t> : std::true_type {};
+template <> struct is_fixed_element<uint16_t> : std::true_type {};
+template <> struct is_fixed_element<int32_t> : std::true_type {};
+template <> struct is_fixed_element<uint32_t> : std::true_type {};
+template <> struct is_fixed_element<int64_t> : std::true_type {};
+template <> struct is_fixed_element<uint64_t> : std::true_type {};
+template <> struct is_fixed_element<double> : std::true_type {};
 
 template <
 typename T1,
@@ -286,30 +817,53 @@ typename T1,
          typename T16 // nobody needs more than 16
          >
 struct type< Struct<T1, T2, T3, T4, T5, T6, T7, T8, T9, T10, T11, T12, T13, T14, T15, T16> >
+  : sig_join< sig_string<'('>,
+    type<T1>, type<T2>, type<T3>, type<T4>,
+    type<T5>, type<T6>, type<T7>, type<T8>,
+    type<T9>, type<T10>, type<T11>, type<T12>,
+    type<T13>, type<T14>, type<T15>, type<T16>,
+    sig_string<')'> >
+{};
+
+template <typename... T>
+struct type< std::tuple<T...> >
+  : sig_join< sig_string<'('>, type<T>..., sig_string<')'> >
+{};
+
+constexpr bool sig_equal(const char *a, const char *b)
 {
-  static std::string sig()
+  return *a == *b && (*a == '\0' || sig_equal(a + 1, b + 1));
+}
+
+template <typename T, bool Static = has_static_sig< type<T> >::value>
+struct sig_check
+{
+  static constexpr bool matches(const char *sig)
+  {
+    return sig_equal(type<T>::value, sig);
+  }
+};
+
+template <typename T>
+struct sig_check<T, false>
+{
+  static constexpr bool matches(const char *)
   {
-    return "("
-           + type<T1>::sig()
-           + type<T2>::sig()
-           + type<T3>::sig()
-           + type<T4>::sig()
-           + type<T5>::sig()
-           + type<T6>::sig()
-           + type<T7>::sig()
-           + type<T8>::sig()
-           + type<T9>::sig()
-           + type<T10>::sig()
-           + type<T11>::sig()
-           + type<T12>::sig()
-           + type<T13>::sig()
-           + type<T14>::sig()
-           + type<T15>::sig()
-           + type<T16>::sig()
-           + ")";
+    return false;
   }
 };
 
+/* true if the compile-time signature of T is sig; generated unmarshalers
+ * static_assert this for every argument they read through
+ * Message::unchecked_reader(), since a mismatch there is not caught at run
+ * time. Types with only a runtime sig() never match.
+ */
+template <typename T>
+constexpr bool sig_matches(const char *sig)
+{
+  return sig_check<T>::matches(sig);
+}
+
 extern DXXAPI DBus::MessageIter &operator << (DBus::MessageIter &iter, const DBus::Variant &val);
 
 inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const DBus::Invalid &)
@@ -389,10 +943,25 @@ inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const DBus::Sign
   return iter;
 }
 
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const DBus::StringView &val)
+{
+  iter.append_string(val.c_str());
+  return iter;
+}
+
+template<typename T>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const DBus::ArrayView<T>& val)
+{
+  DBus::MessageIter ait = iter.new_array(DBus::type<T>::value);
+  ait.append_array(DBus::type<T>::value[0], val.data(), val.size());
+  iter.close_container(ait);
+  return iter;
+}
+
 template<typename E>
 inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<E>& val)
 {
-  const std::string sig = DBus::type<E>::sig();
+  const DBus::sig_cstr< DBus::type<E> > sig;
   DBus::MessageIter ait = iter.new_array(sig.c_str());
 
   typename std::vector<E>::const_iterator vit;
@@ -405,32 +974,308 @@ inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vecto
   return iter;
 }
 
+/* vectors of fixed-size types are written in one block through
+ * dbus_message_iter_append_fixed_array() instead of element by element
+ */
+template<typename E>
+inline void append_fixed_vector(DBus::MessageIter &iter, const std::vector<E>& val)
+{
+  DBus::MessageIter ait = iter.new_array(DBus::type<E>::value);
+  ait.append_array(DBus::type<E>::value[0], val.data(), val.size());
+  iter.close_container(ait);
+}
+
 template<>
 inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<uint8_t>& val)
 {
-  DBus::MessageIter ait = iter.new_array("y");
-  ait.append_array('y', &val.front(), val.size());
+  append_fixed_vector(iter, val);
+  return iter;
+}
+
+template<>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<int16_t>& val)
+{
+  append_fixed_vector(iter, val);
+  return iter;
+}
+
+template<>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<uint16_t>& val)
+{
+  append_fixed_vector(iter, val);
+  return iter;
+}
+
+template<>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<int32_t>& val)
+{
+  append_fixed_vector(iter, val);
+  return iter;
+}
+
+template<>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<uint32_t>& val)
+{
+  append_fixed_vector(iter, val);
+  return iter;
+}
+
+template<>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<int64_t>& val)
+{
+  append_fixed_vector(iter, val);
+  return iter;
+}
+
+template<>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<uint64_t>& val)
+{
+  append_fixed_vector(iter, val);
+  return iter;
+}
+
+template<>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<double>& val)
+{
+  append_fixed_vector(iter, val);
+  return iter;
+}
+
+/* D-Bus booleans are 32 bit wide on the wire. These convert count of them
+ * from and to flags packed 64 to a word (flag i in bit i % 64 of word
+ * i / 64, the rest of the last word cleared), with the widest vector unit
+ * the CPU offers.
+ */
+extern DXXAPI void widen_bools(const uint64_t *words, size_t count, uint32_t *wide);
+
+extern DXXAPI void narrow_bools(const uint32_t *wide, size_t count, uint64_t *words);
+
+/* flags [first, first + count) of a std::vector<bool> as packed words,
+ * first being a multiple of 64: the vector's own storage where the standard
+ * library packs it that way, else a copy in words
+ */
+extern DXXAPI const uint64_t *bool_words(const std::vector<bool> &bits, size_t first, size_t count, uint64_t *words);
+
+/* stores count flags at first in bits, which must already hold them
+ */
+extern DXXAPI void narrow_bools(const uint32_t *wide, size_t count, std::vector<bool> &bits, size_t first);
+
+/* flags converted at a time, the buffers live on the stack
+ */
+const size_t bool_block = 1024;
+
+/* flags [first, first + n) of bits as packed words; first is a multiple of 64
+ */
+template <typename Bits>
+inline const uint64_t *bool_words(const Bits &bits, size_t first, size_t n, uint64_t *words)
+{
+  for (size_t i = 0; i < n; i += 64)
+  {
+    const size_t m = std::min(n - i, size_t(64));
+    uint64_t w = 0;
+
+    for (size_t k = 0; k < m; ++k)
+    {
+      w |= uint64_t(bits[first + i + k]) << k;
+    }
+    words[i / 64] = w;
+  }
+  return words;
+}
+
+/* stores count flags at first in bits, which must already hold them
+ */
+template <typename Bits>
+inline void set_bools(Bits &bits, size_t first, const uint32_t *wide, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    bits[first + i] = wide[i] != 0;
+  }
+}
+
+inline void set_bools(std::vector<bool> &bits, size_t first, const uint32_t *wide, size_t count)
+{
+  DBus::narrow_bools(wide, count, bits, first);
+}
+
+/* std::bitset does not expose its words. libstdc++ keeps them in the packed
+ * layout of widen_bools(), the bits past N cleared, so they are used in
+ * place; elsewhere sets of up to bool_block flags are shifted 64 flags at
+ * a time, which takes a pass over the set per word, and larger ones go
+ * flag by flag
+ */
+template <size_t N>
+inline const uint64_t *bool_words(const std::bitset<N> &bits, size_t first, size_t n, uint64_t *words)
+{
+#if defined(__GLIBCXX__) && __SIZEOF_LONG__ == 8
+  return reinterpret_cast<const uint64_t *>(&bits) + first / 64;
+#else
+  if (N > bool_block)
+  {
+    for (size_t i = 0; i < n; ++i)
+      words[i / 64] = (i % 64 ? words[i / 64] : 0) | uint64_t(bits[first + i]) << (i % 64);
+    return words;
+  }
+
+  const std::bitset<N> low(~0ULL);
+
+  for (size_t i = 0; i < n; i += 64)
+    words[i / 64] = ((bits >> (first + i)) & low).to_ullong();
+  return words;
+#endif
+}
+
+template <size_t N>
+inline void set_bools(std::bitset<N> &bits, size_t first, const uint32_t *wide, size_t count)
+{
+#if defined(__GLIBCXX__) && __SIZEOF_LONG__ == 8
+  if (first == 0 && count == N)
+  {
+    DBus::narrow_bools(wide, count, reinterpret_cast<uint64_t *>(&bits));
+    return;
+  }
+#else
+  if (first == 0 && count == N && N <= bool_block)
+  {
+    uint64_t words[bool_block / 64];
+
+    DBus::narrow_bools(wide, count, words);
+    bits.reset();
+
+    for (size_t i = (N + 63) / 64; i--; )
+      bits = (bits << 64) | std::bitset<N>(words[i]);
+    return;
+  }
+#endif
+  for (size_t i = 0; i < count; ++i)
+  {
+    bits[first + i] = wide[i] != 0;
+  }
+}
+
+template <typename Bits>
+inline void append_bools(DBus::MessageIter &iter, const Bits &bits, size_t count)
+{
+  uint64_t words[bool_block / 64];
+  uint32_t wide[bool_block];
+
+  DBus::MessageIter ait = iter.new_array("b");
+
+  for (size_t first = 0; first < count; first += bool_block)
+  {
+    const size_t n = std::min(count - first, bool_block);
+
+    DBus::widen_bools(bool_words(bits, first, n, words), n, wide);
+    ait.append_array('b', wide, n);
+  }
+
   iter.close_container(ait);
+}
+
+template<>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::vector<bool>& val)
+{
+  append_bools(iter, val, val.size());
   return iter;
 }
 
-template<typename K, typename V>
-inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::map<K, V>& val)
+template<size_t N>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::bitset<N>& val)
+{
+  append_bools(iter, val, N);
+  return iter;
+}
+
+/* writes [begin, end) as an array of E, element by element
+ */
+template<typename E, typename It>
+inline void append_range(DBus::MessageIter &iter, It begin, It end)
+{
+  const DBus::sig_cstr< DBus::type<E> > sig;
+  DBus::MessageIter ait = iter.new_array(sig.c_str());
+
+  for (; begin != end; ++begin)
+  {
+    ait << *begin;
+  }
+
+  iter.close_container(ait);
+}
+
+/* writes the (key, value) pairs in [begin, end) as a dictionary
+ */
+template<typename K, typename V, typename It>
+inline void append_dict(DBus::MessageIter &iter, It begin, It end)
 {
-  const std::string sig = "{" + DBus::type<K>::sig() + DBus::type<V>::sig() + "}";
+  const DBus::sig_cstr< DBus::sig_join< DBus::sig_string<'{'>, DBus::type<K>, DBus::type<V>, DBus::sig_string<'}'> > > sig;
   DBus::MessageIter ait = iter.new_array(sig.c_str());
 
-  typename std::map<K, V>::const_iterator mit;
-  for (mit = val.begin(); mit != val.end(); ++mit)
+  for (; begin != end; ++begin)
   {
     DBus::MessageIter eit = ait.new_dict_entry();
 
-    eit << mit->first << mit->second;
+    eit << begin->first << begin->second;
 
     ait.close_container(eit);
   }
 
   iter.close_container(ait);
+}
+
+template<typename K, typename V>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::map<K, V>& val)
+{
+  append_dict<K, V>(iter, val.begin(), val.end());
+  return iter;
+}
+
+template<typename K, typename V>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::unordered_map<K, V>& val)
+{
+  append_dict<K, V>(iter, val.begin(), val.end());
+  return iter;
+}
+
+template<typename E, size_t N>
+inline void append_std_array(DBus::MessageIter &iter, const std::array<E, N>& val, std::true_type)
+{
+  DBus::MessageIter ait = iter.new_array(DBus::type<E>::value);
+  ait.append_array(DBus::type<E>::value[0], val.data(), N);
+  iter.close_container(ait);
+}
+
+template<typename E, size_t N>
+inline void append_std_array(DBus::MessageIter &iter, const std::array<E, N>& val, std::false_type)
+{
+  append_range<E>(iter, val.begin(), val.end());
+}
+
+template<typename E, size_t N>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::array<E, N>& val)
+{
+  append_std_array(iter, val, DBus::is_fixed_element<E>());
+  return iter;
+}
+
+template<typename E>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::set<E>& val)
+{
+  append_range<E>(iter, val.begin(), val.end());
+  return iter;
+}
+
+template<typename E>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::deque<E>& val)
+{
+  append_range<E>(iter, val.begin(), val.end());
+  return iter;
+}
+
+template<typename E>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::list<E>& val)
+{
+  append_range<E>(iter, val.begin(), val.end());
   return iter;
 }
 
@@ -466,6 +1311,62 @@ inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const DBus::Stru
   return iter;
 }
 
+/* streams the members of a std::tuple in order, I is the next member
+ */
+template <size_t I, size_t N>
+struct tuple_members
+{
+  template <typename Tuple>
+  static void append(DBus::MessageIter &iter, const Tuple &val)
+  {
+    iter << std::get<I>(val);
+    tuple_members<I + 1, N>::append(iter, val);
+  }
+
+  template <typename Tuple>
+  static void get(DBus::MessageIter &iter, Tuple &val)
+  {
+    iter >> std::get<I>(val);
+    tuple_members<I + 1, N>::get(iter, val);
+  }
+};
+
+template <size_t N>
+struct tuple_members<N, N>
+{
+  template <typename Tuple>
+  static void append(DBus::MessageIter &, const Tuple &)
+  {}
+
+  template <typename Tuple>
+  static void get(DBus::MessageIter &, Tuple &)
+  {}
+};
+
+template <typename... T>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::tuple<T...>& val)
+{
+  DBus::MessageIter sit = iter.new_struct();
+
+  tuple_members<0, sizeof...(T)>::append(sit, val);
+
+  iter.close_container(sit);
+
+  return iter;
+}
+
+template<typename A, typename B>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::pair<A, B>& val)
+{
+  DBus::MessageIter sit = iter.new_struct();
+
+  sit << val.first << val.second;
+
+  iter.close_container(sit);
+
+  return iter;
+}
+
 extern DXXAPI DBus::MessageIter &operator << (DBus::MessageIter &iter, const DBus::Variant &val);
 
 inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, DBus::Invalid &)
@@ -545,42 +1446,170 @@ inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, DBus::Signature
   return ++iter;
 }
 
-extern DXXAPI DBus::MessageIter &operator >> (DBus::MessageIter &iter, DBus::Variant &val);
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, DBus::StringView &val)
+{
+  val = iter.get_string();
+  return ++iter;
+}
 
-template<typename E>
-inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<E>& val)
+template<typename T>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, DBus::ArrayView<T>& val)
 {
   if (!iter.is_array())
     throw DBus::ErrorInvalidArgs("array expected");
 
+  if (iter.array_type() != DBus::type<T>::value[0])
+    throw DBus::ErrorInvalidArgs("fixed-array element type mismatch");
+
   DBus::MessageIter ait = iter.recurse();
 
-  while (!ait.at_end())
-  {
-    E elem;
+  T *array;
+  size_t length = ait.get_array(&array);
 
-    ait >> elem;
+  val = DBus::ArrayView<T>(array, length);
 
-    val.push_back(elem);
-  }
   return ++iter;
 }
 
-template<>
-inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<uint8_t>& val)
+extern DXXAPI DBus::MessageIter &operator >> (DBus::MessageIter &iter, DBus::Variant &val);
+
+template<typename E>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<E>& val)
 {
   if (!iter.is_array())
     throw DBus::ErrorInvalidArgs("array expected");
 
-  if (iter.array_type() != 'y')
-    throw DBus::ErrorInvalidArgs("byte-array expected");
+  /* counting variable-size elements walks the whole array */
+  if (DBus::is_fixed_element<E>::value)
+    val.reserve(val.size() + iter.element_count());
 
   DBus::MessageIter ait = iter.recurse();
 
-  uint8_t *array;
+  while (!ait.at_end())
+  {
+    E elem;
+
+    ait >> elem;
+
+    val.push_back(std::move(elem));
+  }
+  return ++iter;
+}
+
+template<typename E>
+inline void get_fixed_vector(DBus::MessageIter &iter, std::vector<E>& val)
+{
+  if (!iter.is_array())
+    throw DBus::ErrorInvalidArgs("array expected");
+
+  if (iter.array_type() != DBus::type<E>::value[0])
+    throw DBus::ErrorInvalidArgs("fixed-array element type mismatch");
+
+  DBus::MessageIter ait = iter.recurse();
+
+  E *array;
   size_t length = ait.get_array(&array);
 
+  val.reserve(val.size() + length);
   val.insert(val.end(), array, array + length);
+}
+
+template<>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<uint8_t>& val)
+{
+  get_fixed_vector(iter, val);
+  return ++iter;
+}
+
+template<>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<int16_t>& val)
+{
+  get_fixed_vector(iter, val);
+  return ++iter;
+}
+
+template<>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<uint16_t>& val)
+{
+  get_fixed_vector(iter, val);
+  return ++iter;
+}
+
+template<>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<int32_t>& val)
+{
+  get_fixed_vector(iter, val);
+  return ++iter;
+}
+
+template<>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<uint32_t>& val)
+{
+  get_fixed_vector(iter, val);
+  return ++iter;
+}
+
+template<>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<int64_t>& val)
+{
+  get_fixed_vector(iter, val);
+  return ++iter;
+}
+
+template<>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<uint64_t>& val)
+{
+  get_fixed_vector(iter, val);
+  return ++iter;
+}
+
+template<>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<double>& val)
+{
+  get_fixed_vector(iter, val);
+  return ++iter;
+}
+
+/* the 32-bit booleans of the array at iter, which is left in place
+ */
+inline const uint32_t *get_bools(DBus::MessageIter &iter, size_t &length)
+{
+  if (!iter.is_array())
+    throw DBus::ErrorInvalidArgs("array expected");
+
+  if (iter.array_type() != 'b')
+    throw DBus::ErrorInvalidArgs("bool-array expected");
+
+  DBus::MessageIter ait = iter.recurse();
+
+  uint32_t *array;
+  length = ait.get_array(&array);
+  return array;
+}
+
+template<>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::vector<bool>& val)
+{
+  size_t length;
+  const uint32_t *array = get_bools(iter, length);
+  const size_t first = val.size();
+
+  val.resize(first + length);
+  set_bools(val, first, array, length);
+
+  return ++iter;
+}
+
+template<size_t N>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::bitset<N>& val)
+{
+  size_t length;
+  const uint32_t *array = get_bools(iter, length);
+
+  if (length != N)
+    throw DBus::ErrorInvalidArgs("array length mismatch");
+
+  set_bools(val, 0, array, N);
 
   return ++iter;
 }
@@ -602,7 +1631,11 @@ inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::map<K, V>&
 
     eit >> key >> value;
 
-    val[key] = value;
+    // dictionaries written from a std::map arrive sorted, append those in O(1)
+    if (val.empty() || val.key_comp()(val.rbegin()->first, key))
+      val.emplace_hint(val.end(), std::move(key), std::move(value));
+    else
+      val[std::move(key)] = std::move(value);
 
     ++mit;
   }
@@ -610,6 +1643,127 @@ inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::map<K, V>&
   return ++iter;
 }
 
+template<typename K, typename V>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::unordered_map<K, V>& val)
+{
+  if (!iter.is_dict())
+    throw DBus::ErrorInvalidArgs("dictionary value expected");
+
+  /* counting variable-size entries walks the whole dictionary */
+  if (DBus::is_fixed_element<K>::value && DBus::is_fixed_element<V>::value)
+    val.reserve(val.size() + iter.element_count());
+
+  DBus::MessageIter mit = iter.recurse();
+
+  while (!mit.at_end())
+  {
+    K key;
+    V value;
+
+    DBus::MessageIter eit = mit.recurse();
+
+    eit >> key >> value;
+
+    val[std::move(key)] = std::move(value);
+
+    ++mit;
+  }
+
+  return ++iter;
+}
+
+template<typename E, size_t N>
+inline void get_std_array(DBus::MessageIter &iter, std::array<E, N>& val, std::true_type)
+{
+  if (iter.array_type() != DBus::type<E>::value[0])
+    throw DBus::ErrorInvalidArgs("fixed-array element type mismatch");
+
+  DBus::MessageIter ait = iter.recurse();
+
+  E *array;
+  ait.get_array(&array);
+
+  std::copy(array, array + N, val.begin());
+}
+
+template<typename E, size_t N>
+inline void get_std_array(DBus::MessageIter &iter, std::array<E, N>& val, std::false_type)
+{
+  DBus::MessageIter ait = iter.recurse();
+
+  for (size_t i = 0; i < N; ++i)
+  {
+    ait >> val[i];
+  }
+}
+
+template<typename E, size_t N>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::array<E, N>& val)
+{
+  if (!iter.is_array())
+    throw DBus::ErrorInvalidArgs("array expected");
+
+  if (static_cast<size_t>(iter.element_count()) != N)
+    throw DBus::ErrorInvalidArgs("array length mismatch");
+
+  get_std_array(iter, val, DBus::is_fixed_element<E>());
+  return ++iter;
+}
+
+template<typename E>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::set<E>& val)
+{
+  if (!iter.is_array())
+    throw DBus::ErrorInvalidArgs("array expected");
+
+  DBus::MessageIter ait = iter.recurse();
+
+  while (!ait.at_end())
+  {
+    E elem;
+
+    ait >> elem;
+
+    // sorted input is inserted in amortized constant time
+    val.insert(val.end(), std::move(elem));
+  }
+  return ++iter;
+}
+
+/* reads an array into a container that only grows at the back
+ */
+template<typename Seq>
+inline void get_sequence(DBus::MessageIter &iter, Seq &val)
+{
+  if (!iter.is_array())
+    throw DBus::ErrorInvalidArgs("array expected");
+
+  DBus::MessageIter ait = iter.recurse();
+
+  while (!ait.at_end())
+  {
+    typename Seq::value_type elem;
+
+    ait >> elem;
+
+    val.push_back(std::move(elem));
+  }
+}
+
+template<typename E>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::deque<E>& val)
+{
+  get_sequence(iter, val);
+  return ++iter;
+}
+
+template<typename E>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::list<E>& val)
+{
+  get_sequence(iter, val);
+  return ++iter;
+}
+
 template <
 typename T1,
          typename T2,
@@ -640,15 +1794,427 @@ inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, DBus::Struct<T1,
   return ++iter;
 }
 
+template <typename... T>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::tuple<T...>& val)
+{
+  DBus::MessageIter sit = iter.recurse();
+
+  tuple_members<0, sizeof...(T)>::get(sit, val);
+
+  return ++iter;
+}
+
+template<typename A, typename B>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::pair<A, B>& val)
+{
+  DBus::MessageIter sit = iter.recurse();
+
+  sit >> val.first >> val.second;
+
+  return ++iter;
+}
+
+/* Single-pass input range over the elements of an array, each one read only
+ * when the iterator reaches it instead of collecting them all first:
+ *
+ *   DBus::ArrayRange<int32_t> values;
+ *   it >> values;
+ *   for (int32_t v : values) ...
+ *
+ * It borrows the message like ArrayView does, and begin() may be called once.
+ */
+template <typename E>
+class ArrayRange
+{
+public:
+
+  typedef E value_type;
+
+  class iterator
+  {
+  public:
+
+    typedef std::input_iterator_tag iterator_category;
+    typedef E value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const E *pointer;
+    typedef const E &reference;
+
+    iterator() : _it(0)
+    {}
+
+    explicit iterator(MessageIter *it) : _it(it)
+    {
+      next();
+    }
+
+    const E &operator*() const
+    {
+      return _value;
+    }
+
+    const E *operator->() const
+    {
+      return &_value;
+    }
+
+    iterator &operator++()
+    {
+      next();
+      return *this;
+    }
+
+    iterator operator++(int)
+    {
+      iterator prev(*this);
+      next();
+      return prev;
+    }
+
+    bool operator == (const iterator &other) const
+    {
+      return _it == other._it;
+    }
+
+    bool operator != (const iterator &other) const
+    {
+      return _it != other._it;
+    }
+
+  private:
+
+    void next()
+    {
+      if (_it->at_end())
+      {
+        _it = 0;
+        return;
+      }
+
+      // a fresh value each time, containers are appended to by operator >>
+      E value;
+
+      *_it >> value;
+
+      _value = std::move(value);
+    }
+
+    MessageIter *_it;
+    E _value;
+  };
+
+  ArrayRange()
+  {}
+
+  explicit ArrayRange(const MessageIter &elements) : _it(elements)
+  {}
+
+  iterator begin()
+  {
+    return iterator(&_it);
+  }
+
+  iterator end()
+  {
+    return iterator();
+  }
+
+private:
+
+  MessageIter _it;
+};
+
+/* dictionary entries read the same way as two-member structs
+ */
+template <typename K, typename V>
+using DictRange = ArrayRange< std::pair<K, V> >;
+
+template<typename E>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, DBus::ArrayRange<E>& val)
+{
+  if (!iter.is_array())
+    throw DBus::ErrorInvalidArgs("array expected");
+
+  val = DBus::ArrayRange<E>(iter.recurse());
+
+  return ++iter;
+}
+
+/* Output iterator appending each assigned value to an open array, so that
+ * producers can stream elements without building a container:
+ *
+ *   DBus::MessageIter ait = it.new_array("(is)");
+ *   std::copy(first, last, DBus::ArrayInserter< std::tuple<int32_t, std::string> >(ait));
+ *   it.close_container(ait);
+ */
+template <typename E>
+class ArrayInserter
+{
+public:
+
+  typedef std::output_iterator_tag iterator_category;
+  typedef void value_type;
+  typedef void difference_type;
+  typedef void pointer;
+  typedef void reference;
+
+  explicit ArrayInserter(MessageIter &array) : _array(&array)
+  {}
+
+  ArrayInserter &operator = (const E &value)
+  {
+    *_array << value;
+    return *this;
+  }
+
+  ArrayInserter &operator*()
+  {
+    return *this;
+  }
+
+  ArrayInserter &operator++()
+  {
+    return *this;
+  }
+
+  ArrayInserter &operator++(int)
+  {
+    return *this;
+  }
+
+private:
+
+  MessageIter *_array;
+};
+
+/* the same for an open dictionary ("{KV}"), taking (key, value) pairs such
+ * as the elements of a std::map
+ */
+template <typename K, typename V>
+class DictInserter
+{
+public:
+
+  typedef std::output_iterator_tag iterator_category;
+  typedef void value_type;
+  typedef void difference_type;
+  typedef void pointer;
+  typedef void reference;
+
+  explicit DictInserter(MessageIter &dict) : _dict(&dict)
+  {}
+
+  template <typename A, typename B>
+  DictInserter &operator = (const std::pair<A, B> &entry)
+  {
+    const K &key = entry.first;
+    const V &value = entry.second;
+
+    MessageIter eit = _dict->new_dict_entry();
+
+    eit << key << value;
+
+    _dict->close_container(eit);
+    return *this;
+  }
+
+  DictInserter &operator*()
+  {
+    return *this;
+  }
+
+  DictInserter &operator++()
+  {
+    return *this;
+  }
+
+  DictInserter &operator++(int)
+  {
+    return *this;
+  }
+
+private:
+
+  MessageIter *_dict;
+};
+
+#ifdef DBUSXX_HAS_PMR
+
+/* std::pmr containers are filled with every element, key and nested
+ * container allocated from the resource of the container being read into.
+ * Backed by a std::pmr::monotonic_buffer_resource, decoding a large
+ * argument takes a few allocations that are all released together.
+ */
+
+/* a default T, built with mr when T is allocator-aware
+ */
+template <typename T>
+inline T pmr_make(std::pmr::memory_resource *mr)
+{
+  typedef std::pmr::polymorphic_allocator<char> Alloc;
+
+  if constexpr (!std::uses_allocator<T, Alloc>::value)
+    return T();
+  else if constexpr (std::is_constructible<T, std::allocator_arg_t, const Alloc &>::value)
+    return T(std::allocator_arg, Alloc(mr));
+  else
+    return T(Alloc(mr));
+}
+
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::pmr::string &val)
+{
+  iter.append_string(val.c_str());
+  return iter;
+}
+
+template<typename E>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::pmr::vector<E>& val)
+{
+  if constexpr (DBus::is_fixed_element<E>::value)
+  {
+    DBus::MessageIter ait = iter.new_array(DBus::type<E>::value);
+    ait.append_array(DBus::type<E>::value[0], val.data(), val.size());
+    iter.close_container(ait);
+  }
+  else if constexpr (std::is_same<E, bool>::value)
+  {
+    append_bools(iter, val, val.size());
+  }
+  else
+  {
+    append_range<E>(iter, val.begin(), val.end());
+  }
+  return iter;
+}
+
+template<typename K, typename V>
+inline DBus::MessageIter &operator << (DBus::MessageIter &iter, const std::pmr::map<K, V>& val)
+{
+  append_dict<K, V>(iter, val.begin(), val.end());
+  return iter;
+}
+
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::pmr::string &val)
+{
+  val.assign(iter.get_string());
+  return ++iter;
+}
+
+template<typename E>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::pmr::vector<E>& val)
+{
+  if constexpr (DBus::is_fixed_element<E>::value)
+  {
+    if (!iter.is_array())
+      throw DBus::ErrorInvalidArgs("array expected");
+
+    if (iter.array_type() != DBus::type<E>::value[0])
+      throw DBus::ErrorInvalidArgs("fixed-array element type mismatch");
+
+    DBus::MessageIter ait = iter.recurse();
+
+    E *array;
+    size_t length = ait.get_array(&array);
+
+    val.insert(val.end(), array, array + length);
+  }
+  else
+  {
+    if (!iter.is_array())
+      throw DBus::ErrorInvalidArgs("array expected");
+
+    DBus::MessageIter ait = iter.recurse();
+
+    while (!ait.at_end())
+    {
+      // emplace_back() hands the vector's resource down to the element
+      val.emplace_back();
+
+      ait >> val.back();
+    }
+  }
+  return ++iter;
+}
+
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::pmr::vector<bool>& val)
+{
+  size_t length;
+  const uint32_t *array = get_bools(iter, length);
+  const size_t first = val.size();
+
+  val.resize(first + length);
+  set_bools(val, first, array, length);
+
+  return ++iter;
+}
+
+template<typename K, typename V>
+inline DBus::MessageIter &operator >> (DBus::MessageIter &iter, std::pmr::map<K, V>& val)
+{
+  if (!iter.is_dict())
+    throw DBus::ErrorInvalidArgs("dictionary value expected");
+
+  std::pmr::memory_resource *mr = val.get_allocator().resource();
+
+  DBus::MessageIter mit = iter.recurse();
+
+  while (!mit.at_end())
+  {
+    K key = pmr_make<K>(mr);
+    V value = pmr_make<V>(mr);
+
+    DBus::MessageIter eit = mit.recurse();
+
+    eit >> key >> value;
+
+    if (val.empty() || val.key_comp()(val.rbegin()->first, key))
+      val.emplace_hint(val.end(), std::move(key), std::move(value));
+    else
+      val.insert_or_assign(std::move(key), std::move(value));
+
+    ++mit;
+  }
+
+  return ++iter;
+}
+
+#endif//DBUSXX_HAS_PMR
+
+template <typename T>
+inline DBus::Variant::Variant(const T &value)
+  : _type(0), _msg(0), _slice(0)
+{
+  assign(value);
+}
+
 template <typename T>
 inline DBus::Variant::operator T() const
 {
   T cast;
-  DBus::MessageIter ri = _msg.reader();
+
+  if (get_inline(cast))
+    return cast;
+
+  DBus::MessageIter ri = reader();
   ri >> cast;
   return cast;
 }
 
+#ifdef DBUSXX_HAS_PMR
+template <typename T>
+inline T DBus::Variant::get(std::pmr::memory_resource *mr) const
+{
+  T value = pmr_make<T>(mr);
+
+  if (get_inline(value))
+    return value;
+
+  DBus::MessageIter ri = reader();
+  ri >> value;
+  return value;
+}
+#endif
+
 } /* namespace DBus */
 
 #endif//__DBUSXX_TYPES_H
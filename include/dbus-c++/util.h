@@ -29,6 +29,7 @@
 #include <iostream>
 #include <iomanip>
 #include <cassert>
+#include <utility>
 
 #include "api.h"
 #include "debug.h"
@@ -56,6 +57,14 @@ public:
     ref();
   }
 
+  /* steals the counter, the moved-from object holds no reference
+   */
+  RefCnt(RefCnt &&rc)
+  {
+    __ref = rc.__ref;
+    rc.__ref = 0;
+  }
+
   virtual ~RefCnt()
   {
     unref();
@@ -69,24 +78,37 @@ public:
     return *this;
   }
 
+  RefCnt &operator = (RefCnt &&ref)
+  {
+    if (this != &ref)
+    {
+      unref();
+      __ref = ref.__ref;
+      ref.__ref = 0;
+    }
+    return *this;
+  }
+
   bool noref() const
   {
-    return (*__ref) == 0;
+    return !__ref || (*__ref) == 0;
   }
 
   bool one() const
   {
-    return (*__ref) == 1;
+    return __ref && (*__ref) == 1;
   }
 
 private:
 
   DXXAPILOCAL void ref() const
   {
-    ++ (*__ref);
+    if (__ref) ++ (*__ref);
   }
   DXXAPILOCAL void unref() const
   {
+    if (!__ref) return;
+
     -- (*__ref);
 
     if ((*__ref) < 0)
@@ -116,6 +138,10 @@ public:
 
   RefPtrI(T *ptr = 0);
 
+  RefPtrI(const RefPtrI &ref)
+    : __ptr(ref.__ptr), __cnt(ref.__cnt)
+  {}
+
   ~RefPtrI();
 
   RefPtrI &operator = (const RefPtrI &ref)
@@ -130,6 +156,25 @@ public:
     return *this;
   }
 
+  RefPtrI(RefPtrI &&ref)
+    : __ptr(ref.__ptr), __cnt(std::move(ref.__cnt))
+  {
+    ref.__ptr = 0;
+  }
+
+  RefPtrI &operator = (RefPtrI &&ref)
+  {
+    if (this != &ref)
+    {
+      if (__cnt.one()) delete __ptr;
+
+      __ptr = ref.__ptr;
+      __cnt = std::move(ref.__cnt);
+      ref.__ptr = 0;
+    }
+    return *this;
+  }
+
   T &operator *() const
   {
     return *__ptr;
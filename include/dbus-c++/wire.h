@@ -0,0 +1,615 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef __DBUSXX_WIRE_H
+#define __DBUSXX_WIRE_H
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+
+#include "api.h"
+#include "types.h"
+#include "message.h"
+
+namespace DBus
+{
+
+/*
+ *   Native D-Bus serializer
+ *
+ * Writes a message body in the D-Bus wire format (host byte order) straight
+ * into a contiguous, growable buffer instead of going through libdbus one
+ * value at a time:
+ *
+ *   DBus::WireWriter w;
+ *   w << name << values << DBus::Variant(...);
+ *
+ *   DBus::CallMessage head("org.example", "/org/example", "org.example.Iface", "Put");
+ *   conn.send(w.message(head));
+ *
+ * The top level values append to signature(); containers must be opened
+ * and closed in order, as with MessageIter. Strings, object paths and
+ * signatures are validated as they are appended (throwing ErrorInvalidArgs)
+ * unless trusted(true) was called; message() hands the result to
+ * dbus_message_demarshal(), which rejects any malformed body with an Error.
+ */
+class DXXAPI WireWriter
+{
+public:
+
+  WireWriter(size_t capacity = 256);
+
+  ~WireWriter();
+
+  void append_byte(uint8_t b)
+  {
+    top("y");
+    put(b);
+  }
+
+  void append_bool(bool b)
+  {
+    top("b");
+    align(4);
+    put<uint32_t>(b ? 1 : 0);
+  }
+
+  void append_int16(int16_t i)
+  {
+    top("n");
+    align(2);
+    put(i);
+  }
+
+  void append_uint16(uint16_t u)
+  {
+    top("q");
+    align(2);
+    put(u);
+  }
+
+  void append_int32(int32_t i)
+  {
+    top("i");
+    align(4);
+    put(i);
+  }
+
+  void append_uint32(uint32_t u)
+  {
+    top("u");
+    align(4);
+    put(u);
+  }
+
+  void append_int64(int64_t i)
+  {
+    top("x");
+    align(8);
+    put(i);
+  }
+
+  void append_uint64(uint64_t u)
+  {
+    top("t");
+    align(8);
+    put(u);
+  }
+
+  void append_double(double d)
+  {
+    top("d");
+    align(8);
+    put(d);
+  }
+
+  void append_string(const char *chars, size_t length)
+  {
+    if (_checked) check('s', chars, length);
+    top("s");
+    put_string(chars, length);
+  }
+
+  void append_path(const char *chars, size_t length)
+  {
+    if (_checked) check('o', chars, length);
+    top("o");
+    put_string(chars, length);
+  }
+
+  void append_signature(const char *chars, size_t length)
+  {
+    if (_checked) check('g', chars, length);
+    top("g");
+    put_signature(chars, length);
+  }
+
+  /* writes an array of fixed-size elements in one block,
+   * as MessageIter::new_array() + MessageIter::append_array()
+   */
+  void append_array(char type, const void *ptr, size_t length);
+
+  /* appends count booleans packed 64 to a word (see widen_bools()) to the
+   * open "b" array
+   */
+  void append_bools(const uint64_t *words, size_t count)
+  {
+    reserve(count * 4);
+    widen_bools(words, count, (uint32_t *)(_data + _size));
+    _size += count * 4;
+  }
+
+  /* copies the value at \a it, including its contents if it is a container
+   */
+  void append_iter(MessageIter &it);
+
+  void append_variant(const Variant &v);
+
+  /* \a sig is the element signature, as for MessageIter::new_array()
+   */
+  void open_array(const char *sig);
+
+  void close_array();
+
+  /* \a sig is the full signature of the struct, e.g. "(is)"
+   */
+  void open_struct(const char *sig);
+
+  void close_struct();
+
+  void open_dict_entry();
+
+  void close_dict_entry();
+
+  /* \a sig is the signature of the contained value
+   */
+  void open_variant(const char *sig);
+
+  void close_variant();
+
+  const std::string &signature() const
+  {
+    return _signature;
+  }
+
+  const unsigned char *data() const
+  {
+    return _data;
+  }
+
+  size_t size() const
+  {
+    return _size;
+  }
+
+  void clear();
+
+  /* skips validating strings, object paths and signatures, for input that
+   * is known to be valid
+   */
+  void trusted(bool t)
+  {
+    _checked = !t;
+  }
+
+  bool trusted() const
+  {
+    return !_checked;
+  }
+
+  /*!
+   * \brief Builds a message with the type, flags and header fields of
+   *        \a head and the body written so far.
+   *
+   * The serial is left unset, so that Connection::send() assigns one. The
+   * header is written into spare room in front of the body, so the body is
+   * copied by libdbus only (on loading and on clearing the serial again).
+   */
+  Message message(const Message &head);
+
+private:
+
+  WireWriter(const WireWriter &);
+
+  WireWriter &operator = (const WireWriter &);
+
+  void grow(size_t n);
+
+  void check(char type, const char *chars, size_t length) const;
+
+  /* copies a container read in place by its bytes, see Message::wire_reader()
+   */
+  DXXAPILOCAL bool append_subtree(MessageIter &it);
+
+  DXXAPILOCAL void put_header(const Message &head, uint32_t serial, WireWriter &out) const;
+
+  void reserve(size_t n)
+  {
+    if (_size + n > _capacity)
+      grow(n);
+  }
+
+  void align(size_t n)
+  {
+    size_t pad = (n - (_size & (n - 1))) & (n - 1);
+
+    reserve(pad);
+    while (pad--)
+      _data[_size++] = 0;
+  }
+
+  template <typename T>
+  void put(T value)
+  {
+    reserve(sizeof(T));
+    memcpy(_data + _size, &value, sizeof(T));
+    _size += sizeof(T);
+  }
+
+  void put_bytes(const void *ptr, size_t length)
+  {
+    reserve(length);
+    memcpy(_data + _size, ptr, length);
+    _size += length;
+  }
+
+  void put_string(const char *chars, size_t length)
+  {
+    align(4);
+    put<uint32_t>(length);
+    put_bytes(chars, length + 1);
+  }
+
+  void put_signature(const char *chars, size_t length)
+  {
+    /* the length is a single byte, even for trusted input */
+    if (length > 255)
+      throw ErrorInvalidArgs("signature too long");
+
+    put<uint8_t>(length);
+    put_bytes(chars, length + 1);
+  }
+
+  /* only values written outside of any container make up the body signature
+   */
+  void top(const char *sig)
+  {
+    if (_depth == 0)
+      _signature += sig;
+  }
+
+  unsigned char *_data;
+  size_t _size;
+  size_t _capacity;
+  int _depth;
+  bool _checked;
+  std::string _signature;
+
+  /* offsets of the length fields of the open arrays
+   */
+  std::vector<size_t> _arrays;
+};
+
+inline WireWriter &operator << (WireWriter &w, const Invalid &)
+{
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const uint8_t &val)
+{
+  w.append_byte(val);
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const bool &val)
+{
+  w.append_bool(val);
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const int16_t &val)
+{
+  w.append_int16(val);
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const uint16_t &val)
+{
+  w.append_uint16(val);
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const int32_t &val)
+{
+  w.append_int32(val);
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const uint32_t &val)
+{
+  w.append_uint32(val);
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const int64_t &val)
+{
+  w.append_int64(val);
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const uint64_t &val)
+{
+  w.append_uint64(val);
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const double &val)
+{
+  w.append_double(val);
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const std::string &val)
+{
+  w.append_string(val.c_str(), val.length());
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const StringView &val)
+{
+  w.append_string(val.c_str(), val.length());
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const Path &val)
+{
+  w.append_path(val.c_str(), val.length());
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const Signature &val)
+{
+  w.append_signature(val.c_str(), val.length());
+  return w;
+}
+
+inline WireWriter &operator << (WireWriter &w, const Variant &val)
+{
+  w.append_variant(val);
+  return w;
+}
+
+template<typename T>
+inline WireWriter &operator << (WireWriter &w, const ArrayView<T>& val)
+{
+  w.append_array(type<T>::value[0], val.data(), val.size());
+  return w;
+}
+
+template<typename E, typename It>
+inline void wire_append_range(WireWriter &w, It begin, It end)
+{
+  const sig_cstr< type<E> > sig;
+
+  w.open_array(sig.c_str());
+  for (; begin != end; ++begin)
+  {
+    w << *begin;
+  }
+  w.close_array();
+}
+
+template<typename E>
+inline void wire_append_vector(WireWriter &w, const std::vector<E>& val, std::true_type)
+{
+  w.append_array(type<E>::value[0], val.data(), val.size());
+}
+
+template<typename E>
+inline void wire_append_vector(WireWriter &w, const std::vector<E>& val, std::false_type)
+{
+  wire_append_range<E>(w, val.begin(), val.end());
+}
+
+template<typename E>
+inline WireWriter &operator << (WireWriter &w, const std::vector<E>& val)
+{
+  wire_append_vector(w, val, is_fixed_element<E>());
+  return w;
+}
+
+template<typename Bits>
+inline void wire_append_bools(WireWriter &w, const Bits &bits, size_t count)
+{
+  uint64_t words[bool_block / 64];
+
+  w.open_array("b");
+  for (size_t first = 0; first < count; first += bool_block)
+  {
+    const size_t n = std::min(count - first, bool_block);
+
+    w.append_bools(bool_words(bits, first, n, words), n);
+  }
+  w.close_array();
+}
+
+template<>
+inline WireWriter &operator << (WireWriter &w, const std::vector<bool>& val)
+{
+  wire_append_bools(w, val, val.size());
+  return w;
+}
+
+template<size_t N>
+inline WireWriter &operator << (WireWriter &w, const std::bitset<N>& val)
+{
+  wire_append_bools(w, val, N);
+  return w;
+}
+
+template<typename E, size_t N>
+inline void wire_append_std_array(WireWriter &w, const std::array<E, N>& val, std::true_type)
+{
+  w.append_array(type<E>::value[0], val.data(), N);
+}
+
+template<typename E, size_t N>
+inline void wire_append_std_array(WireWriter &w, const std::array<E, N>& val, std::false_type)
+{
+  wire_append_range<E>(w, val.begin(), val.end());
+}
+
+template<typename E, size_t N>
+inline WireWriter &operator << (WireWriter &w, const std::array<E, N>& val)
+{
+  wire_append_std_array(w, val, is_fixed_element<E>());
+  return w;
+}
+
+template<typename E>
+inline WireWriter &operator << (WireWriter &w, const std::set<E>& val)
+{
+  wire_append_range<E>(w, val.begin(), val.end());
+  return w;
+}
+
+template<typename E>
+inline WireWriter &operator << (WireWriter &w, const std::deque<E>& val)
+{
+  wire_append_range<E>(w, val.begin(), val.end());
+  return w;
+}
+
+template<typename E>
+inline WireWriter &operator << (WireWriter &w, const std::list<E>& val)
+{
+  wire_append_range<E>(w, val.begin(), val.end());
+  return w;
+}
+
+template<typename K, typename V, typename It>
+inline void wire_append_dict(WireWriter &w, It begin, It end)
+{
+  const sig_cstr< sig_join< sig_string<'{'>, type<K>, type<V>, sig_string<'}'> > > sig;
+
+  w.open_array(sig.c_str());
+  for (; begin != end; ++begin)
+  {
+    w.open_dict_entry();
+    w << begin->first << begin->second;
+    w.close_dict_entry();
+  }
+  w.close_array();
+}
+
+template<typename K, typename V>
+inline WireWriter &operator << (WireWriter &w, const std::map<K, V>& val)
+{
+  wire_append_dict<K, V>(w, val.begin(), val.end());
+  return w;
+}
+
+template<typename K, typename V>
+inline WireWriter &operator << (WireWriter &w, const std::unordered_map<K, V>& val)
+{
+  wire_append_dict<K, V>(w, val.begin(), val.end());
+  return w;
+}
+
+template <size_t I, size_t N>
+struct wire_tuple_members
+{
+  template <typename Tuple>
+  static void append(WireWriter &w, const Tuple &val)
+  {
+    w << std::get<I>(val);
+    wire_tuple_members<I + 1, N>::append(w, val);
+  }
+};
+
+template <size_t N>
+struct wire_tuple_members<N, N>
+{
+  template <typename Tuple>
+  static void append(WireWriter &, const Tuple &)
+  {}
+};
+
+template <typename... T>
+inline WireWriter &operator << (WireWriter &w, const std::tuple<T...>& val)
+{
+  const sig_cstr< type< std::tuple<T...> > > sig;
+
+  w.open_struct(sig.c_str());
+  wire_tuple_members<0, sizeof...(T)>::append(w, val);
+  w.close_struct();
+  return w;
+}
+
+template<typename A, typename B>
+inline WireWriter &operator << (WireWriter &w, const std::pair<A, B>& val)
+{
+  const sig_cstr< type< std::pair<A, B> > > sig;
+
+  w.open_struct(sig.c_str());
+  w << val.first << val.second;
+  w.close_struct();
+  return w;
+}
+
+template <
+typename T1,
+         typename T2,
+         typename T3,
+         typename T4,
+         typename T5,
+         typename T6,
+         typename T7,
+         typename T8,
+         typename T9,
+         typename T10,
+         typename T11,
+         typename T12,
+         typename T13,
+         typename T14,
+         typename T15,
+         typename T16
+         >
+inline WireWriter &operator << (WireWriter &w, const Struct<T1, T2, T3, T4, T5, T6, T7, T8, T9, T10, T11, T12, T13, T14, T15, T16>& val)
+{
+  const sig_cstr< type< Struct<T1, T2, T3, T4, T5, T6, T7, T8, T9, T10, T11, T12, T13, T14, T15, T16> > > sig;
+
+  w.open_struct(sig.c_str());
+  w << val._1 << val._2 << val._3 << val._4
+    << val._5 << val._6 << val._7 << val._8
+    << val._9 << val._10 << val._11 << val._12
+    << val._13 << val._14 << val._15 << val._16;
+  w.close_struct();
+  return w;
+}
+
+} /* namespace DBus */
+
+#endif//__DBUSXX_WIRE_H
@@ -0,0 +1,226 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus-c++/types.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DBUSXX_SIMD_BOOLS 1
+#include <immintrin.h>
+#endif
+
+using namespace DBus;
+
+typedef void (*WidenFunction)(const uint64_t *, size_t, size_t, uint32_t *);
+typedef void (*NarrowFunction)(const uint32_t *, size_t, size_t, uint64_t *);
+
+/* the loops below handle elements [i, count); the vector versions do what
+ * they can in blocks and leave the rest to these
+ */
+static void widen_scalar(const uint64_t *words, size_t i, size_t count, uint32_t *wide)
+{
+  for (; i < count; ++i)
+    wide[i] = (words[i / 64] >> (i % 64)) & 1;
+}
+
+static void narrow_scalar(const uint32_t *wide, size_t i, size_t count, uint64_t *words)
+{
+  // i is a multiple of 64 here, the last word is cleared past count
+  for (; i < count; i += 64)
+  {
+    const size_t n = count - i < 64 ? count - i : 64;
+    uint64_t w = 0;
+
+    for (size_t k = 0; k < n; ++k)
+      w |= uint64_t(wide[i + k] != 0) << k;
+
+    words[i / 64] = w;
+  }
+}
+
+#ifdef DBUSXX_SIMD_BOOLS
+
+/* each flag byte is broadcast to all lanes and tested against one bit per
+ * lane; the words are little-endian, so byte k holds flags 8k to 8k+7
+ */
+__attribute__((target("sse2")))
+static void widen_sse2(const uint64_t *words, size_t i, size_t count, uint32_t *wide)
+{
+  const unsigned char *bytes = (const unsigned char *)words;
+  const __m128i low = _mm_setr_epi32(1, 2, 4, 8);
+  const __m128i high = _mm_setr_epi32(16, 32, 64, 128);
+
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m128i b = _mm_set1_epi32(bytes[i / 8]);
+
+    _mm_storeu_si128((__m128i *)(wide + i), _mm_srli_epi32(_mm_cmpeq_epi32(_mm_and_si128(b, low), low), 31));
+    _mm_storeu_si128((__m128i *)(wide + i + 4), _mm_srli_epi32(_mm_cmpeq_epi32(_mm_and_si128(b, high), high), 31));
+  }
+  widen_scalar(words, i, count, wide);
+}
+
+__attribute__((target("avx2")))
+static void widen_avx2(const uint64_t *words, size_t i, size_t count, uint32_t *wide)
+{
+  const unsigned char *bytes = (const unsigned char *)words;
+  const __m256i bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m256i b = _mm256_set1_epi32(bytes[i / 8]);
+
+    _mm256_storeu_si256((__m256i *)(wide + i), _mm256_srli_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(b, bit), bit), 31));
+  }
+  // see skip_ascii_avx2() in validate.cpp
+  _mm256_zeroupper();
+  widen_scalar(words, i, count, wide);
+}
+
+/* D-Bus booleans are 0 or 1 (libdbus rejects anything else on receipt), a
+ * compare against zero and a movemask give eight flags at a time
+ */
+__attribute__((target("sse2")))
+static void narrow_sse2(const uint32_t *wide, size_t i, size_t count, uint64_t *words)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  for (; i + 64 <= count; i += 64)
+  {
+    uint64_t w = 0;
+
+    for (size_t k = 0; k < 64; k += 4)
+    {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(wide + i + k));
+      const unsigned m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, zero)));
+
+      w |= uint64_t(~m & 0xf) << k;
+    }
+    words[i / 64] = w;
+  }
+  narrow_scalar(wide, i, count, words);
+}
+
+__attribute__((target("avx2")))
+static void narrow_avx2(const uint32_t *wide, size_t i, size_t count, uint64_t *words)
+{
+  const __m256i zero = _mm256_setzero_si256();
+
+  for (; i + 64 <= count; i += 64)
+  {
+    uint64_t w = 0;
+
+    for (size_t k = 0; k < 64; k += 8)
+    {
+      const __m256i v = _mm256_loadu_si256((const __m256i *)(wide + i + k));
+      const unsigned m = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, zero)));
+
+      w |= uint64_t(~m & 0xff) << k;
+    }
+    words[i / 64] = w;
+  }
+  _mm256_zeroupper();
+  narrow_scalar(wide, i, count, words);
+}
+
+#endif//DBUSXX_SIMD_BOOLS
+
+static WidenFunction select_widen()
+{
+#ifdef DBUSXX_SIMD_BOOLS
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    return widen_avx2;
+  if (__builtin_cpu_supports("sse2"))
+    return widen_sse2;
+#endif
+  return widen_scalar;
+}
+
+static NarrowFunction select_narrow()
+{
+#ifdef DBUSXX_SIMD_BOOLS
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    return narrow_avx2;
+  if (__builtin_cpu_supports("sse2"))
+    return narrow_sse2;
+#endif
+  return narrow_scalar;
+}
+
+void DBus::widen_bools(const uint64_t *words, size_t count, uint32_t *wide)
+{
+  static const WidenFunction widen = select_widen();
+
+  widen(words, 0, count, wide);
+}
+
+void DBus::narrow_bools(const uint32_t *wide, size_t count, uint64_t *words)
+{
+  static const NarrowFunction narrow = select_narrow();
+
+  narrow(wide, 0, count, words);
+}
+
+/* libstdc++ keeps std::vector<bool> in exactly the packed layout above, so
+ * its storage is used in place; elsewhere it goes flag by flag
+ */
+const uint64_t *DBus::bool_words(const std::vector<bool> &bits, size_t first, size_t count, uint64_t *words)
+{
+#if defined(__GLIBCXX__) && __SIZEOF_LONG__ == 8
+  return reinterpret_cast<const uint64_t *>(bits.begin()._M_p) + first / 64;
+#else
+  for (size_t i = 0; i < count; i += 64)
+  {
+    const size_t n = count - i < 64 ? count - i : 64;
+    uint64_t w = 0;
+
+    for (size_t k = 0; k < n; ++k)
+      w |= uint64_t(bits[first + i + k]) << k;
+
+    words[i / 64] = w;
+  }
+  return words;
+#endif
+}
+
+void DBus::narrow_bools(const uint32_t *wide, size_t count, std::vector<bool> &bits, size_t first)
+{
+#if defined(__GLIBCXX__) && __SIZEOF_LONG__ == 8
+  // narrow_bools() clears the tail of the last word, which is only safe
+  // when the flags end the vector
+  if (first % 64 == 0 && first + count == bits.size())
+  {
+    narrow_bools(wide, count, reinterpret_cast<uint64_t *>(bits.begin()._M_p) + first / 64);
+    return;
+  }
+#endif
+  for (size_t i = 0; i < count; ++i)
+    bits[first + i] = wide[i] != 0;
+}
@@ -38,17 +38,20 @@
 #include "server_p.h"
 #include "message_p.h"
 #include "pendingcall_p.h"
+#include "transport_p.h"
 
 using namespace DBus;
 
+static const int drain_interval = 10; // ms, see Connection::Private::drain_timeout
+
 Connection::Private::Private(DBusConnection *c, Server::Private *s)
-  : conn(c) , dispatcher(NULL), server(s)
+  : conn(c), transport(NULL), dispatcher(NULL), server(s)
 {
   init();
 }
 
 Connection::Private::Private(DBusBusType type)
-  : dispatcher(NULL), server(NULL)
+  : transport(NULL), dispatcher(NULL), server(NULL)
 {
   InternalError e;
 
@@ -59,12 +62,36 @@ Connection::Private::Private(DBusBusType type)
   init();
 }
 
+Connection::Private::Private(NativeTransport *t)
+  : conn(NULL), transport(t), dispatcher(NULL), server(NULL)
+{
+  transport->watch.owner = this;
+  transport->write_watch.owner = this;
+  transport->wakeup_watch.owner = this;
+  transport->cork_timeout.owner = this;
+
+  init();
+}
+
 Connection::Private::~Private()
 {
   debug_log("terminating connection 0x%08x", conn);
 
   detach_server();
 
+  if (transport)
+  {
+    // the bus releases the names along with the socket
+    if (dispatcher)
+      native_unwatch(dispatcher);
+
+    delete transport;
+    return;
+  }
+
+  if (dispatcher && drain_timeout.timeout)
+    dispatcher->rem_timeout(drain_timeout.timeout);
+
   if (dbus_connection_get_is_connected(conn))
   {
     std::vector<std::string>::iterator i = names.begin();
@@ -82,13 +109,29 @@ Connection::Private::~Private()
 
 void Connection::Private::init()
 {
-  dbus_connection_ref(conn);
-  dbus_connection_ref(conn);	//todo: the library has to own another reference
-
   disconn_filter = new Callback<Connection::Private, bool, const Message &>(
     this, &Connection::Private::disconn_filter_function
   );
 
+  high_size = low_size = 0;
+  high_messages = low_messages = 0;
+  above = false;
+  dispatching = NULL;
+
+  drain_timeout.interval = drain_interval;
+  drain_timeout.enabled = false;
+  drain_timeout.owner = this;
+  drain_timeout.timeout = NULL;
+
+  if (transport)
+  {
+    filters.push_back(&disconn_filter);
+    return;
+  }
+
+  dbus_connection_ref(conn);
+  dbus_connection_ref(conn);	//todo: the library has to own another reference
+
   dbus_connection_add_filter(conn, message_filter_stub, &disconn_filter, NULL); // TODO: some assert at least
 
   dbus_connection_set_dispatch_status_function(conn, dispatch_status_stub, this, 0);
@@ -116,8 +159,227 @@ void Connection::Private::detach_server()
   	}*/
 }
 
+bool Connection::Private::register_object_path(const char *path, const DBusObjectPathVTable *vtable, void *data)
+{
+  if (!transport)
+    return dbus_connection_register_object_path(conn, path, vtable, data);
+
+  handlers_mutex.lock();
+  object_paths[path] = std::make_pair(vtable, data);
+  handlers_mutex.unlock();
+  return true;
+}
+
+void Connection::Private::unregister_object_path(const char *path)
+{
+  if (!transport)
+  {
+    dbus_connection_unregister_object_path(conn, path);
+    return;
+  }
+
+  const DBusObjectPathVTable *vtable = NULL;
+  void *data = NULL;
+
+  handlers_mutex.lock();
+
+  ObjectPathTable::iterator o = object_paths.find(path);
+
+  if (o != object_paths.end())
+  {
+    vtable = o->second.first;
+    data = o->second.second;
+    object_paths.erase(o);
+  }
+
+  handlers_mutex.unlock();
+
+  if (vtable && vtable->unregister_function)
+    vtable->unregister_function(NULL, data);
+}
+
+void Connection::Private::native_watch(Dispatcher *d)
+{
+  NativeWatch *const watches[] = { &transport->watch, &transport->write_watch, &transport->wakeup_watch };
+
+  for (size_t i = 0; i < sizeof(watches) / sizeof(watches[0]); ++i)
+    watches[i]->watch = d->add_watch(watches[i]->internal());
+  transport->cork_timeout.timeout = d->add_timeout(transport->cork_timeout.internal());
+}
+
+void Connection::Private::native_unwatch(Dispatcher *d)
+{
+  NativeWatch *const watches[] = { &transport->watch, &transport->write_watch, &transport->wakeup_watch };
+
+  for (size_t i = 0; i < sizeof(watches) / sizeof(watches[0]); ++i)
+  {
+    if (watches[i]->watch)
+      d->rem_watch(watches[i]->watch);
+    watches[i]->watch = NULL;
+  }
+
+  if (transport->cork_timeout.timeout)
+    d->rem_timeout(transport->cork_timeout.timeout);
+  transport->cork_timeout.timeout = NULL;
+}
+
+bool Connection::Private::native_watch_ready(NativeWatch *watch, int flags)
+{
+  if (watch == &transport->write_watch)
+  {
+    transport->write_ready();
+    check_watermarks();
+    return true;
+  }
+
+  if (watch == &transport->wakeup_watch)
+  {
+    transport->woken();
+    return true;
+  }
+
+  transport->read_available();
+  native_queue();
+  return true;
+}
+
+bool Connection::Private::native_timeout_expired(NativeTimeout *timeout)
+{
+  if (transport && timeout == &transport->cork_timeout)
+    transport->cork_expired();
+
+  check_watermarks();
+  return true;
+}
+
+void Connection::Private::check_watermarks()
+{
+  watermark_mutex.lock();
+
+  if (!high_size && !high_messages && !above)
+  {
+    watermark_mutex.unlock();
+    return;
+  }
+
+  size_t size, messages = 0;
+
+  if (transport)
+    transport->outgoing(size, messages);
+  else
+    size = dbus_connection_get_outgoing_size(conn);
+
+  const bool was_above = above;
+
+  if (!above)
+    above = (high_size && size >= (size_t)high_size) || (high_messages && messages >= (size_t)high_messages);
+  else
+    above = (high_size && size > (size_t)low_size) || (high_messages && messages > (size_t)low_messages);
+
+  if (drain_timeout.timeout && drain_timeout.enabled != above)
+  {
+    drain_timeout.enabled = above;
+    drain_timeout.timeout->toggle();
+  }
+
+  const bool now_above = above;
+  WatermarkSlot slot = watermark;
+
+  watermark_mutex.unlock();
+
+  // outside the lock, the slot may well send
+  if (now_above != was_above && !slot.empty())
+    slot.call(now_above);
+}
+
+void Connection::Private::native_queue(bool wake)
+{
+  if (dispatcher && transport->has_incoming())
+  {
+    dispatcher->queue_connection(this);
+    if (wake)
+      transport->wake();
+  }
+}
+
+/* one incoming message through the steps dbus_connection_dispatch() takes:
+ * the peer interface, filters, then the handler registered for its path
+ */
+bool Connection::Private::native_dispatch()
+{
+  std::list<Message> current;
+
+  if (!transport->pop(current))
+    return true;
+
+  Message &msg = current.front();
+  DBusMessage *dmsg = msg._pvt->msg;
+  const bool call = dbus_message_get_type(dmsg) == DBUS_MESSAGE_TYPE_METHOD_CALL;
+  bool handled = false;
+
+  if (call && dbus_message_is_method_call(dmsg, DBUS_INTERFACE_PEER, "Ping"))
+  {
+    DBusMessage *pong = dbus_message_new_method_return(dmsg);
+
+    transport->send(pong, NULL);
+    dbus_message_unref(pong);
+    handled = true;
+  }
+
+  // filters added or removed by a filter take effect with the next message
+  handlers_mutex.lock();
+  std::list<MessageSlot *> current_filters(filters);
+  handlers_mutex.unlock();
+
+  for (std::list<MessageSlot *>::iterator f = current_filters.begin(); !handled && f != current_filters.end(); ++f)
+    handled = !(*f)->empty() && (*f)->call(msg);
+
+  const char *path = dbus_message_get_path(dmsg);
+
+  if (!handled && path)
+  {
+    const DBusObjectPathVTable *vtable = NULL;
+    void *data = NULL;
+
+    handlers_mutex.lock();
+
+    ObjectPathTable::iterator o = object_paths.find(path);
+
+    if (o != object_paths.end())
+    {
+      vtable = o->second.first;
+      data = o->second.second;
+    }
+
+    handlers_mutex.unlock();
+
+    if (vtable)
+    {
+      dispatching = &msg;
+      handled = vtable->message_function(NULL, dmsg, data) == DBUS_HANDLER_RESULT_HANDLED;
+      dispatching = NULL;
+    }
+  }
+
+  if (!handled && call && !dbus_message_get_no_reply(dmsg))
+  {
+    DBusMessage *error = dbus_message_new_error_printf(dmsg, DBUS_ERROR_UNKNOWN_METHOD,
+                         "Method \"%s\" with signature \"%s\" on interface \"%s\" doesn't exist\n",
+                         dbus_message_get_member(dmsg), dbus_message_get_signature(dmsg),
+                         dbus_message_get_interface(dmsg) ? dbus_message_get_interface(dmsg) : "(null)");
+
+    transport->send(error, NULL);
+    dbus_message_unref(error);
+  }
+
+  return !transport->has_incoming();
+}
+
 bool Connection::Private::do_dispatch()
 {
+  if (transport)
+    return native_dispatch();
+
   debug_log("dispatching on %p", conn);
 
   if (!dbus_connection_get_is_connected(conn))
@@ -169,7 +431,11 @@ bool Connection::Private::disconn_filter_function(const Message &msg)
   if (msg.is_signal(DBUS_INTERFACE_LOCAL, "Disconnected"))
   {
     debug_log("%p disconnected by local bus", conn);
-    dbus_connection_close(conn);
+
+    if (transport)
+      transport->close();
+    else
+      dbus_connection_close(conn);
 
     return true;
   }
@@ -183,27 +449,62 @@ DBusDispatchStatus Connection::Private::dispatch_status()
 
 bool Connection::Private::has_something_to_dispatch()
 {
+  if (transport)
+    return transport->has_incoming();
+
   return dispatch_status() == DBUS_DISPATCH_DATA_REMAINS;
 }
 
+/* what dbus_bus_get_private() does, over the native transport
+ */
+static Connection native_bus(DBusBusType type)
+{
+  Connection conn(new Connection::Private(new NativeTransport(NativeTransport::bus_address(type).c_str())));
+
+  conn.register_bus();
+  return conn;
+}
 
 Connection Connection::SystemBus()
 {
   return Connection(new Private(DBUS_BUS_SYSTEM));
 }
 
+Connection Connection::SystemBus(Transport transport)
+{
+  if (transport == Native)
+    return native_bus(DBUS_BUS_SYSTEM);
+
+  return SystemBus();
+}
+
 Connection Connection::SessionBus()
 {
   return Connection(new Private(DBUS_BUS_SESSION));
 }
 
+Connection Connection::SessionBus(Transport transport)
+{
+  if (transport == Native)
+    return native_bus(DBUS_BUS_SESSION);
+
+  return SessionBus();
+}
+
 Connection Connection::ActivationBus()
 {
   return Connection(new Private(DBUS_BUS_STARTER));
 }
 
-Connection::Connection(const char *address, bool priv)
-  : _timeout(-1)
+Connection Connection::ActivationBus(Transport transport)
+{
+  if (transport == Native)
+    return native_bus(DBUS_BUS_STARTER);
+
+  return ActivationBus();
+}
+
+static DBusConnection *open_address(const char *address, bool priv)
 {
   InternalError e;
   DBusConnection *conn = priv
@@ -212,7 +513,33 @@ Connection::Connection(const char *address, bool priv)
 
   if (e) throw Error(e);
 
-  _pvt = new Private(conn);
+  return conn;
+}
+
+Connection::Connection(const char *address, bool priv)
+  : _timeout(-1)
+{
+  _pvt = new Private(open_address(address, priv));
+
+  setup(default_dispatcher);
+
+  debug_log("connected to %s", address);
+}
+
+Connection::Connection(const char *address, bool priv, Transport transport)
+  : _timeout(-1)
+{
+  if (transport == Native)
+  {
+    _pvt = new Private(new NativeTransport(address));
+
+    setup(default_dispatcher);
+
+    debug_log("connected to %s without libdbus", address);
+    return;
+  }
+
+  _pvt = new Private(open_address(address, priv));
 
   setup(default_dispatcher);
 
@@ -228,12 +555,14 @@ Connection::Connection(Connection::Private *p)
 Connection::Connection(const Connection &c)
   : _pvt(c._pvt), _timeout(c._timeout)
 {
-  dbus_connection_ref(_pvt->conn);
+  if (_pvt->conn)
+    dbus_connection_ref(_pvt->conn);
 }
 
 Connection::~Connection()
 {
-  dbus_connection_unref(_pvt->conn);
+  if (_pvt->conn)
+    dbus_connection_unref(_pvt->conn);
 }
 
 Dispatcher *Connection::setup(Dispatcher *dispatcher)
@@ -250,6 +579,15 @@ Dispatcher *Connection::setup(Dispatcher *dispatcher)
 
   dispatcher->queue_connection(_pvt.get());
 
+  if (_pvt->transport)
+  {
+    if (prev)
+      _pvt->native_unwatch(prev);
+    if (_pvt->transport->connected())
+      _pvt->native_watch(dispatcher);
+    return prev;
+  }
+
   dbus_connection_set_watch_functions(
     _pvt->conn,
     Dispatcher::Private::on_add_watch,
@@ -268,16 +606,36 @@ Dispatcher *Connection::setup(Dispatcher *dispatcher)
     0
   );
 
+  if (prev && _pvt->drain_timeout.timeout)
+    prev->rem_timeout(_pvt->drain_timeout.timeout);
+  _pvt->drain_timeout.timeout = dispatcher->add_timeout(_pvt->drain_timeout.internal());
+
   return prev;
 }
 
 bool Connection::operator == (const Connection &c) const
 {
+  if (_pvt->transport)
+    return _pvt.get() == c._pvt.get();
+
   return _pvt->conn == c._pvt->conn;
 }
 
 bool Connection::register_bus()
 {
+  if (_pvt->transport)
+  {
+    if (!_pvt->transport->unique_name.empty())
+      return true;
+
+    CallMessage hello(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS, "Hello");
+    Message reply = send_blocking(hello);
+    MessageIter ri = reply.reader();
+
+    _pvt->transport->unique_name = ri.get_string();
+    return true;
+  }
+
   InternalError e;
 
   bool r = dbus_bus_register(_pvt->conn, e);
@@ -289,37 +647,85 @@ bool Connection::register_bus()
 
 bool Connection::connected() const
 {
+  if (_pvt->transport)
+    return _pvt->transport->connected();
+
   return dbus_connection_get_is_connected(_pvt->conn);
 }
 
 void Connection::disconnect()
 {
+  if (_pvt->transport)
+  {
+    _pvt->transport->close();
+    _pvt->native_queue(true);
+    return;
+  }
+
 //	dbus_connection_disconnect(_pvt->conn); // disappeared in 0.9x
   dbus_connection_close(_pvt->conn);
 }
 
 void Connection::exit_on_disconnect(bool exit)
 {
+  if (_pvt->transport)
+    return;
+
   dbus_connection_set_exit_on_disconnect(_pvt->conn, exit);
 }
 
 bool Connection::unique_name(const char *n)
 {
+  if (_pvt->transport)
+  {
+    if (!_pvt->transport->unique_name.empty())
+      return false;
+
+    _pvt->transport->unique_name = n;
+    return true;
+  }
+
   return dbus_bus_set_unique_name(_pvt->conn, n);
 }
 
 const char *Connection::unique_name() const
 {
+  if (_pvt->transport)
+    return _pvt->transport->unique_name.empty() ? NULL : _pvt->transport->unique_name.c_str();
+
   return dbus_bus_get_unique_name(_pvt->conn);
 }
 
 void Connection::flush()
 {
-  dbus_connection_flush(_pvt->conn);
+  if (_pvt->transport)
+    _pvt->transport->flush();
+  else
+    dbus_connection_flush(_pvt->conn);
+
+  _pvt->check_watermarks();
+}
+
+/* method call to the bus driver, for the native transport
+ */
+static CallMessage bus_method(const char *method)
+{
+  return CallMessage(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS, method);
 }
 
 void Connection::add_match(const char *rule)
 {
+  if (_pvt->transport)
+  {
+    CallMessage call = bus_method("AddMatch");
+
+    call.append(DBUS_TYPE_STRING, &rule, DBUS_TYPE_INVALID);
+    send_blocking(call);
+
+    debug_log("%s: added match rule %s", unique_name(), rule);
+    return;
+  }
+
   InternalError e;
 
   dbus_bus_add_match(_pvt->conn, rule, e);
@@ -332,6 +738,28 @@ void Connection::add_match(const char *rule)
 void Connection::remove_match(const char	*rule,
                               bool		throw_on_error)
 {
+  if (_pvt->transport)
+  {
+    CallMessage call = bus_method("RemoveMatch");
+
+    call.append(DBUS_TYPE_STRING, &rule, DBUS_TYPE_INVALID);
+
+    try
+    {
+      send_blocking(call);
+    }
+    catch (Error &e)
+    {
+      if (throw_on_error)
+        throw;
+
+      debug_log("DBus::Connection::remove_match: %s (%s).", e.message(), e.name());
+    }
+
+    debug_log("%s: removed match rule %s", unique_name(), rule);
+    return;
+  }
+
   InternalError e;
 
   dbus_bus_remove_match(_pvt->conn, rule, e);
@@ -352,22 +780,229 @@ void Connection::remove_match(const char	*rule,
 bool Connection::add_filter(MessageSlot &s)
 {
   debug_log("%s: adding filter", unique_name());
+
+  if (_pvt->transport)
+  {
+    _pvt->handlers_mutex.lock();
+    _pvt->filters.push_back(&s);
+    _pvt->handlers_mutex.unlock();
+    return true;
+  }
+
   return dbus_connection_add_filter(_pvt->conn, Private::message_filter_stub, &s, NULL);
 }
 
 void Connection::remove_filter(MessageSlot &s)
 {
   debug_log("%s: removing filter", unique_name());
+
+  if (_pvt->transport)
+  {
+    _pvt->handlers_mutex.lock();
+
+    // the most recently added instance, as libdbus does
+    for (std::list<MessageSlot *>::iterator f = _pvt->filters.end(); f != _pvt->filters.begin(); )
+    {
+      if (*--f == &s)
+      {
+        _pvt->filters.erase(f);
+        break;
+      }
+    }
+
+    _pvt->handlers_mutex.unlock();
+    return;
+  }
+
   dbus_connection_remove_filter(_pvt->conn, Private::message_filter_stub, &s);
 }
 
 bool Connection::send(const Message &msg, unsigned int *serial)
 {
-  return dbus_connection_send(_pvt->conn, msg._pvt->msg, serial);
+  const bool sent = _pvt->transport
+                    ? _pvt->transport->send(msg._pvt->msg, serial)
+                    : dbus_connection_send(_pvt->conn, msg._pvt->msg, serial);
+
+  _pvt->check_watermarks();
+  return sent;
+}
+
+bool Connection::try_send(const Message &msg, unsigned int *serial)
+{
+  // the queue may have drained since anybody last looked
+  _pvt->check_watermarks();
+
+  if (above_watermark())
+    return false;
+
+  const bool sent = _pvt->transport
+                    ? _pvt->transport->send(msg._pvt->msg, serial)
+                    : dbus_connection_send(_pvt->conn, msg._pvt->msg, serial);
+
+  _pvt->check_watermarks();
+  return sent;
+}
+
+long Connection::outgoing_size()
+{
+  if (_pvt->transport)
+  {
+    size_t bytes, frames;
+
+    _pvt->transport->outgoing(bytes, frames);
+    return bytes;
+  }
+
+  return dbus_connection_get_outgoing_size(_pvt->conn);
+}
+
+long Connection::outgoing_unix_fds()
+{
+  if (_pvt->transport)
+    return 0;
+
+  return dbus_connection_get_outgoing_unix_fds(_pvt->conn);
+}
+
+long Connection::outgoing_messages()
+{
+  if (!_pvt->transport)
+    return -1;
+
+  size_t bytes, frames;
+
+  _pvt->transport->outgoing(bytes, frames);
+  return frames;
+}
+
+bool Connection::set_watermarks(long high_size, long low_size, long high_messages, long low_messages)
+{
+  if (!_pvt->transport && high_messages)
+    return false;
+
+  _pvt->watermark_mutex.lock();
+  _pvt->high_size = high_size;
+  _pvt->low_size = low_size;
+  _pvt->high_messages = high_messages;
+  _pvt->low_messages = low_messages;
+  _pvt->watermark_mutex.unlock();
+
+  _pvt->check_watermarks();
+  return true;
+}
+
+WatermarkSlot &Connection::watermark()
+{
+  return _pvt->watermark;
+}
+
+bool Connection::above_watermark()
+{
+  _pvt->watermark_mutex.lock();
+  const bool above = _pvt->above;
+  _pvt->watermark_mutex.unlock();
+  return above;
+}
+
+void Connection::set_max_message_size(long size)
+{
+  if (_pvt->transport)
+    _pvt->transport->set_max_message_size(size);
+  else
+    dbus_connection_set_max_message_size(_pvt->conn, size);
+}
+
+long Connection::get_max_message_size()
+{
+  if (_pvt->transport)
+    return _pvt->transport->max_message_size;
+
+  return dbus_connection_get_max_message_size(_pvt->conn);
+}
+
+void Connection::set_max_received_size(long size)
+{
+  if (_pvt->transport)
+    _pvt->transport->set_max_received_size(size);
+  else
+    dbus_connection_set_max_received_size(_pvt->conn, size);
+}
+
+long Connection::get_max_received_size()
+{
+  if (_pvt->transport)
+    return _pvt->transport->max_received_size;
+
+  return dbus_connection_get_max_received_size(_pvt->conn);
+}
+
+bool Connection::set_cork(unsigned int budget_us, size_t bytes)
+{
+  if (!_pvt->transport)
+    return false;
+
+  _pvt->transport->set_cork(budget_us, bytes);
+  return true;
+}
+
+bool Connection::set_priority_lanes(bool on)
+{
+  if (!_pvt->transport)
+    return false;
+
+  _pvt->transport->set_prioritized(on);
+  return true;
+}
+
+std::vector<unsigned int> Connection::send_batch(const std::vector<Message> &messages)
+{
+  std::vector<unsigned int> serials(messages.size(), 0);
+
+  if (_pvt->transport)
+  {
+    std::vector<DBusMessage *> msgs(messages.size());
+
+    for (size_t i = 0; i < messages.size(); ++i)
+      msgs[i] = messages[i]._pvt->msg;
+
+    if (!msgs.empty())
+      _pvt->transport->send_batch(&msgs[0], msgs.size(), &serials[0]);
+    _pvt->check_watermarks();
+    return serials;
+  }
+
+  for (size_t i = 0; i < messages.size(); ++i)
+  {
+    dbus_uint32_t serial;
+
+    if (dbus_connection_send(_pvt->conn, messages[i]._pvt->msg, &serial))
+      serials[i] = serial;
+  }
+  dbus_connection_flush(_pvt->conn);
+  _pvt->check_watermarks();
+
+  return serials;
 }
 
 Message Connection::send_blocking(Message &msg, int timeout)
 {
+  if (_pvt->transport)
+  {
+    try
+    {
+      Message reply = _pvt->transport->send_blocking(msg._pvt->msg, _timeout != -1 ? _timeout : timeout);
+
+      // whatever arrived meanwhile waits for the dispatcher
+      _pvt->native_queue(true);
+      return reply;
+    }
+    catch (...)
+    {
+      _pvt->native_queue(true);
+      throw;
+    }
+  }
+
   DBusMessage *reply;
   InternalError e;
 
@@ -387,6 +1022,9 @@ Message Connection::send_blocking(Message &msg, int timeout)
 
 PendingCall Connection::send_async(Message &msg, int timeout)
 {
+  if (_pvt->transport)
+    throw ErrorNotSupported("the native transport has no pending calls, use send_blocking()");
+
   DBusPendingCall *pending;
 
   if (!dbus_connection_send_with_reply(_pvt->conn, msg._pvt->msg, &pending, timeout))
@@ -407,7 +1045,22 @@ void Connection::request_name(const char *name, int flags)
    * Think about giving back the 'ret' value. Some people on the list
    * requested about this...
    */
-  int ret = dbus_bus_request_name(_pvt->conn, name, flags, e);
+  int ret;
+
+  if (_pvt->transport)
+  {
+    CallMessage call = bus_method("RequestName");
+    dbus_uint32_t f = flags;
+
+    call.append(DBUS_TYPE_STRING, &name, DBUS_TYPE_UINT32, &f, DBUS_TYPE_INVALID);
+
+    Message reply = send_blocking(call);
+    MessageIter ri = reply.reader();
+
+    ret = ri.get_uint32();
+  }
+  else
+    ret = dbus_bus_request_name(_pvt->conn, name, flags, e);
 
   if (ret == -1)
   {
@@ -426,6 +1079,18 @@ void Connection::request_name(const char *name, int flags)
 
 unsigned long Connection::sender_unix_uid(const char *sender)
 {
+  if (_pvt->transport)
+  {
+    CallMessage call = bus_method("GetConnectionUnixUser");
+
+    call.append(DBUS_TYPE_STRING, &sender, DBUS_TYPE_INVALID);
+
+    Message reply = send_blocking(call);
+    MessageIter ri = reply.reader();
+
+    return ri.get_uint32();
+  }
+
   InternalError e;
 
   unsigned long ul = dbus_bus_get_unix_user(_pvt->conn, sender, e);
@@ -437,6 +1102,18 @@ unsigned long Connection::sender_unix_uid(const char *sender)
 
 bool Connection::has_name(const char *name)
 {
+  if (_pvt->transport)
+  {
+    CallMessage call = bus_method("NameHasOwner");
+
+    call.append(DBUS_TYPE_STRING, &name, DBUS_TYPE_INVALID);
+
+    Message reply = send_blocking(call);
+    MessageIter ri = reply.reader();
+
+    return ri.get_bool();
+  }
+
   InternalError e;
 
   bool b = dbus_bus_name_has_owner(_pvt->conn, name, e);
@@ -453,6 +1130,16 @@ const std::vector<std::string>& Connection::names()
 
 bool Connection::start_service(const char *name, unsigned long flags)
 {
+  if (_pvt->transport)
+  {
+    CallMessage call = bus_method("StartServiceByName");
+    dbus_uint32_t f = flags;
+
+    call.append(DBUS_TYPE_STRING, &name, DBUS_TYPE_UINT32, &f, DBUS_TYPE_INVALID);
+    send_blocking(call);
+    return true;
+  }
+
   InternalError e;
 
   bool b = dbus_bus_start_service_by_name(_pvt->conn, name, flags, NULL, e);
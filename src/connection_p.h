@@ -36,8 +36,12 @@
 
 #include <dbus/dbus.h>
 
+#include <list>
+#include <map>
 #include <string>
 
+#include "transport_p.h"
+
 namespace DBus
 {
 
@@ -45,6 +49,27 @@ struct DXXAPILOCAL Connection::Private
 {
   DBusConnection 	*conn;
 
+  /* set instead of conn when the connection uses the native transport,
+   * which then also keeps the filters and object paths libdbus would
+   */
+  NativeTransport *transport;
+
+  std::list<MessageSlot *> filters;
+
+  typedef std::map<std::string, std::pair<const DBusObjectPathVTable *, void *> > ObjectPathTable;
+  ObjectPathTable object_paths;
+
+  /* filters and object_paths are changed from any thread but read by
+   * native_dispatch() on the dispatcher's
+   */
+  DefaultMutex handlers_mutex;
+
+  /* the message native_dispatch() is handing to an object path's handler,
+   * which takes it from here rather than rewrapping the bare DBusMessage
+   * and losing the frame it was read from
+   */
+  Message *dispatching;
+
   std::vector<std::string> names;
 
   Dispatcher *dispatcher;
@@ -53,6 +78,24 @@ struct DXXAPILOCAL Connection::Private
   MessageSlot disconn_filter;
   bool disconn_filter_function(const Message &);
 
+  /* outgoing queue watermarks, 0 for none; above is set from reaching a
+   * high mark until both low marks are reached again
+   */
+  long high_size, low_size;
+  long high_messages, low_messages;
+  bool above;
+  WatermarkSlot watermark;
+  DefaultMutex watermark_mutex;
+
+  /* libdbus writes what a send left queued from its watches without
+   * telling us, so while above its queue is looked at periodically
+   */
+  NativeTimeout drain_timeout;
+
+  /* calls watermark if the queue crossed a mark since the last call
+   */
+  void check_watermarks();
+
   Server::Private *server;
   void detach_server();
 
@@ -60,10 +103,37 @@ struct DXXAPILOCAL Connection::Private
 
   Private(DBusBusType);
 
+  Private(NativeTransport *);
+
   ~Private();
 
   void init();
 
+  bool register_object_path(const char *path, const DBusObjectPathVTable *, void *);
+
+  void unregister_object_path(const char *path);
+
+  /* hands the native transport's watches and timeout to d, or takes them
+   * back
+   */
+  void native_watch(Dispatcher *d);
+
+  void native_unwatch(Dispatcher *d);
+
+  /* Watch::handle() for the native transport's watches, Timeout::handle()
+   * for its cork timeout and for drain_timeout
+   */
+  bool native_watch_ready(NativeWatch *, int flags);
+
+  bool native_timeout_expired(NativeTimeout *);
+
+  bool native_dispatch();
+
+  /* queues the connection for dispatching if messages wait; other threads
+   * than the dispatcher's set wake, or it may not see them until it wakes
+   */
+  void native_queue(bool wake = false);
+
   DBusDispatchStatus dispatch_status();
   bool has_something_to_dispatch();
 
@@ -32,6 +32,7 @@
 #include "dispatcher_p.h"
 #include "server_p.h"
 #include "connection_p.h"
+#include "transport_p.h"
 
 DBus::Dispatcher *DBus::default_dispatcher = NULL;
 
@@ -40,21 +41,31 @@ using namespace DBus;
 Timeout::Timeout(Timeout::Internal *i)
   : _int(i)
 {
-  dbus_timeout_set_data((DBusTimeout *)i, this, NULL);
+  if (!NativeTimeout::from(i))
+    dbus_timeout_set_data((DBusTimeout *)i, this, NULL);
 }
 
 int Timeout::interval() const
 {
+  if (NativeTimeout *native = NativeTimeout::from(_int))
+    return native->interval;
+
   return dbus_timeout_get_interval((DBusTimeout *)_int);
 }
 
 bool Timeout::enabled() const
 {
+  if (NativeTimeout *native = NativeTimeout::from(_int))
+    return native->enabled;
+
   return dbus_timeout_get_enabled((DBusTimeout *)_int);
 }
 
 bool Timeout::handle()
 {
+  if (NativeTimeout *native = NativeTimeout::from(_int))
+    return native->owner->native_timeout_expired(native);
+
   return dbus_timeout_handle((DBusTimeout *)_int);
 }
 
@@ -64,11 +75,15 @@ bool Timeout::handle()
 Watch::Watch(Watch::Internal *i)
   : _int(i)
 {
-  dbus_watch_set_data((DBusWatch *)i, this, NULL);
+  if (!NativeWatch::from(i))
+    dbus_watch_set_data((DBusWatch *)i, this, NULL);
 }
 
 int Watch::descriptor() const
 {
+  if (NativeWatch *native = NativeWatch::from(_int))
+    return native->fd;
+
 #if HAVE_WIN32
   return dbus_watch_get_socket((DBusWatch *)_int);
 #else
@@ -85,16 +100,25 @@ int Watch::descriptor() const
 
 int Watch::flags() const
 {
+  if (NativeWatch *native = NativeWatch::from(_int))
+    return native->flags;
+
   return dbus_watch_get_flags((DBusWatch *)_int);
 }
 
 bool Watch::enabled() const
 {
+  if (NativeWatch *native = NativeWatch::from(_int))
+    return native->enabled;
+
   return dbus_watch_get_enabled((DBusWatch *)_int);
 }
 
 bool Watch::handle(int flags)
 {
+  if (NativeWatch *native = NativeWatch::from(_int))
+    return native->owner->native_watch_ready(native, flags);
+
   return dbus_watch_handle((DBusWatch *)_int, flags);
 }
 
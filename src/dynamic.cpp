@@ -0,0 +1,757 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus-c++/dynamic.h>
+#include <dbus-c++/error.h>
+#include <dbus-c++/eventloop.h>
+#include <dbus/dbus.h>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#include "message_p.h"
+#include "wire_p.h"
+#include "internalerror.h"
+
+using namespace DBus;
+
+struct ValueArena::Block
+{
+  Block *next;
+  size_t size;
+};
+
+ValueArena::ValueArena(size_t block_size)
+  : _blocks(0), _next(0), _end(0), _block_size(block_size)
+{
+}
+
+ValueArena::~ValueArena()
+{
+  while (_blocks)
+  {
+    Block *next = _blocks->next;
+    free(_blocks);
+    _blocks = next;
+  }
+}
+
+void *ValueArena::allocate(size_t size, size_t align)
+{
+  char *p = (char *)wire_align((size_t)_next, align);
+
+  if (!_blocks || p + size > _end)
+  {
+    // oversized requests get a block of their own
+    const size_t room = size + align > _block_size ? size + align : _block_size;
+    Block *block = (Block *)malloc(sizeof(Block) + room);
+
+    if (!block)
+      throw std::bad_alloc();
+
+    block->next = _blocks;
+    block->size = room;
+    _blocks = block;
+    _next = (char *)(block + 1);
+    _end = _next + room;
+
+    p = (char *)wire_align((size_t)_next, align);
+  }
+
+  _next = p + size;
+  return p;
+}
+
+void ValueArena::clear()
+{
+  if (!_blocks)
+    return;
+
+  Block *keep = _blocks;
+
+  while (keep->next)
+  {
+    Block *next = keep->next->next;
+    free(keep->next);
+    keep->next = next;
+  }
+
+  _next = (char *)(keep + 1);
+  _end = _next + keep->size;
+}
+
+/*
+*/
+
+SignaturePlan::SignaturePlan(const char *signature)
+  : _signature(signature), _count(0)
+{
+  if (!wire_valid_signature(signature, strlen(signature)))
+    throw ErrorInvalidArgs("invalid signature");
+
+  const char *sig = _signature.c_str();
+
+  while (*sig)
+  {
+    compile(sig);
+    ++_count;
+  }
+}
+
+uint32_t SignaturePlan::compile(const char *&sig)
+{
+  const uint32_t index = _steps.size();
+  const char *start = sig;
+  Step step = Step();
+
+  // reserve the slot, the contents are pushed after it
+  _steps.push_back(step);
+
+  step.type = *sig;
+  step.align = wire_alignment(*sig);
+  step.size = wire_fixed_size(*sig);
+  step.members = 0;
+
+  switch (*sig++)
+  {
+  case DBUS_TYPE_ARRAY:
+    compile(sig);
+    break;
+  case DBUS_STRUCT_BEGIN_CHAR:
+    step.type = DBUS_TYPE_STRUCT;
+    while (*sig != DBUS_STRUCT_END_CHAR)
+    {
+      compile(sig);
+      ++step.members;
+    }
+    ++sig;
+    break;
+  case DBUS_DICT_ENTRY_BEGIN_CHAR:
+    step.type = DBUS_TYPE_DICT_ENTRY;
+    while (*sig != DBUS_DICT_ENTRY_END_CHAR)
+    {
+      compile(sig);
+      ++step.members;
+    }
+    ++sig;
+    break;
+  }
+
+  step.next = _steps.size();
+  step.sig = _sigs.size();
+  _sigs.append(start, sig - start);
+  _sigs += '\0';
+
+  _steps[index] = step;
+  return index;
+}
+
+/* plans cached for top level signatures, and as many for signatures found
+ * inside variants, see lookup()
+ */
+static const size_t max_plans = 256;
+
+const SignaturePlan &SignaturePlan::get(const char *signature, std::unique_ptr<SignaturePlan> &once)
+{
+  const SignaturePlan *plan = lookup(signature, false);
+
+  if (plan)
+    return *plan;
+
+  once.reset(new SignaturePlan(signature));
+  return *once;
+}
+
+const SignaturePlan &SignaturePlan::variant(const char *signature, std::unique_ptr<SignaturePlan> &once)
+{
+  const SignaturePlan *plan = lookup(signature, true);
+
+  if (plan)
+    return *plan;
+
+  once.reset(new SignaturePlan(signature));
+  return *once;
+}
+
+const SignaturePlan *SignaturePlan::lookup(const char *signature, bool variant)
+{
+  // variants mostly hold basic values, those plans need no lookup at all
+  static const SignaturePlan *basic[128];
+
+  const unsigned char c = signature[0];
+
+  if (c && !signature[1] && c < 128)
+  {
+    const SignaturePlan *plan = __atomic_load_n(&basic[c], __ATOMIC_ACQUIRE);
+
+    if (plan)
+      return plan;
+  }
+
+  static DefaultMutex mutex;
+  static std::map<std::string, const SignaturePlan *> plans;
+  static size_t kept[2] = { 0, 0 }; // top level, variant contents
+
+  mutex.lock();
+
+  std::map<std::string, const SignaturePlan *>::iterator it = plans.find(signature);
+  const SignaturePlan *plan;
+
+  if (it != plans.end())
+  {
+    plan = it->second;
+  }
+  else if (kept[variant] >= max_plans)
+  {
+    plan = 0;
+  }
+  else
+  {
+    try
+    {
+      plan = new SignaturePlan(signature);
+    }
+    catch (...)
+    {
+      mutex.unlock();
+      throw;
+    }
+    plans[signature] = plan;
+    ++kept[variant];
+
+    if (c && !signature[1] && c < 128)
+      __atomic_store_n(&basic[c], plan, __ATOMIC_RELEASE);
+  }
+
+  mutex.unlock();
+  return plan;
+}
+
+/*
+*/
+
+struct SignaturePlan::Decoder
+{
+  ValueArena &arena;
+
+  /* elements of the arrays being decoded, moved into the arena when the
+   * array is complete
+   */
+  std::vector<DynamicValue> pending;
+
+  Decoder(ValueArena &a) : arena(a)
+  {}
+
+  DynamicValue *values(size_t count)
+  {
+    return (DynamicValue *)arena.allocate(count * sizeof(DynamicValue));
+  }
+
+  DynamicValue *collect(size_t first)
+  {
+    const size_t count = pending.size() - first;
+    DynamicValue *items = values(count);
+
+    if (count)
+      memcpy(items, &pending[first], count * sizeof(DynamicValue));
+    pending.resize(first);
+    return items;
+  }
+
+  const char *copy(const void *chars, size_t length)
+  {
+    char *str = (char *)arena.allocate(length + 1, 1);
+
+    memcpy(str, chars, length);
+    str[length] = '\0';
+    return str;
+  }
+
+  /* decodes the marshalled value at pos, a host-order body as kept by
+   * Message::Private::wire_body()
+   */
+  void wire(const SignaturePlan &plan, uint32_t s, const unsigned char *body, size_t &pos, DynamicValue &v);
+
+  /* decodes the value at it and moves it forward
+   */
+  void iter(const SignaturePlan &plan, uint32_t s, MessageIter &it, DynamicValue &v);
+};
+
+void SignaturePlan::Decoder::wire(const SignaturePlan &plan, uint32_t s, const unsigned char *body, size_t &pos, DynamicValue &v)
+{
+  const Step &step = plan._steps[s];
+
+  v.type = step.type;
+  v.size = 0;
+  v.signature = 0;
+  v.t = 0;
+
+  pos = wire_align(pos, step.align);
+
+  switch (step.type)
+  {
+  case DBUS_TYPE_BOOLEAN:
+  {
+    uint32_t b;
+    memcpy(&b, body + pos, 4);
+    v.b = b != 0;
+    pos += 4;
+    break;
+  }
+  case DBUS_TYPE_STRING:
+  case DBUS_TYPE_OBJECT_PATH:
+  {
+    uint32_t length;
+    memcpy(&length, body + pos, 4);
+    v.str = copy(body + pos + 4, length);
+    v.size = length;
+    pos += 4 + length + 1;
+    break;
+  }
+  case DBUS_TYPE_SIGNATURE:
+    v.size = body[pos];
+    v.str = copy(body + pos + 1, v.size);
+    pos += 1 + v.size + 1;
+    break;
+  case DBUS_TYPE_VARIANT:
+  {
+    // the signature is NUL-terminated in the body
+    std::unique_ptr<SignaturePlan> once;
+    const SignaturePlan &inner = variant((const char *)body + pos + 1, once);
+
+    // an uncached plan goes away with once, the arena keeps the signature
+    v.signature = once ? copy(body + pos + 1, body[pos]) : inner._signature.c_str();
+    pos += 1 + body[pos] + 1;
+    v.size = 1;
+    v.items = values(1);
+    wire(inner, 0, body, pos, v.items[0]);
+    break;
+  }
+  case DBUS_TYPE_ARRAY:
+  {
+    const Step &element = plan._steps[s + 1];
+    uint32_t length;
+
+    memcpy(&length, body + pos, 4);
+    pos = wire_align(pos + 4, element.align);
+
+    if (element.size)
+    {
+      void *data = arena.allocate(length);
+      memcpy(data, body + pos, length);
+
+      v.data = data;
+      v.size = length / element.size;
+      pos += length;
+    }
+    else
+    {
+      const size_t first = pending.size();
+      const size_t end = pos + length;
+
+      while (pos < end)
+      {
+        DynamicValue item;
+        wire(plan, s + 1, body, pos, item);
+        pending.push_back(item);
+      }
+      v.size = pending.size() - first;
+      v.items = collect(first);
+    }
+    break;
+  }
+  case DBUS_TYPE_STRUCT:
+  case DBUS_TYPE_DICT_ENTRY:
+  {
+    v.size = step.members;
+    v.items = values(step.members);
+
+    uint32_t member = s + 1;
+    for (uint32_t i = 0; i < step.members; ++i)
+    {
+      wire(plan, member, body, pos, v.items[i]);
+      member = plan._steps[member].next;
+    }
+    break;
+  }
+  default:
+    // fixed-size basic types; every member of the union starts at its
+    // first byte, whatever the byte order
+    memcpy(&v.t, body + pos, step.size);
+    pos += step.size;
+    break;
+  }
+}
+
+void SignaturePlan::Decoder::iter(const SignaturePlan &plan, uint32_t s, MessageIter &it, DynamicValue &v)
+{
+  const Step &step = plan._steps[s];
+
+  if (it.type() != step.type)
+    throw ErrorInvalidArgs("value does not match the signature");
+
+  v.type = step.type;
+  v.size = 0;
+  v.signature = 0;
+  v.t = 0;
+
+  switch (step.type)
+  {
+  case DBUS_TYPE_STRING:
+  case DBUS_TYPE_OBJECT_PATH:
+  case DBUS_TYPE_SIGNATURE:
+  {
+    const char *chars;
+    it.get_basic(step.type, &chars);
+    v.size = strlen(chars);
+    v.str = copy(chars, v.size);
+    break;
+  }
+  case DBUS_TYPE_BOOLEAN:
+    v.b = it.get_bool();
+    break;
+  case DBUS_TYPE_UNIX_FD:
+    it.get_basic(step.type, &v.h);
+    break;
+  case DBUS_TYPE_VARIANT:
+  {
+    MessageIter vit = it.recurse();
+    char *sig = vit.signature();
+    std::unique_ptr<SignaturePlan> once;
+    const SignaturePlan *inner;
+
+    try
+    {
+      inner = &variant(sig, once);
+    }
+    catch (...)
+    {
+      free(sig);
+      throw;
+    }
+    free(sig);
+
+    // an uncached plan goes away with once, the arena keeps the signature
+    v.signature = once ? copy(inner->_signature.c_str(), inner->_signature.size()) : inner->_signature.c_str();
+    v.size = 1;
+    v.items = values(1);
+    iter(*inner, 0, vit, v.items[0]);
+    break;
+  }
+  case DBUS_TYPE_ARRAY:
+  {
+    const Step &element = plan._steps[s + 1];
+    MessageIter ait = it.recurse();
+
+    if (element.size)
+    {
+      const void *array;
+      const size_t length = ait.get_array(&array);
+      void *data = arena.allocate(length * element.size);
+
+      memcpy(data, array, length * element.size);
+      v.data = data;
+      v.size = length;
+    }
+    else
+    {
+      const size_t first = pending.size();
+
+      while (!ait.at_end())
+      {
+        DynamicValue item;
+        iter(plan, s + 1, ait, item);
+        pending.push_back(item);
+      }
+      v.size = pending.size() - first;
+      v.items = collect(first);
+    }
+    break;
+  }
+  case DBUS_TYPE_STRUCT:
+  case DBUS_TYPE_DICT_ENTRY:
+  {
+    MessageIter sit = it.recurse();
+
+    v.size = step.members;
+    v.items = values(step.members);
+
+    uint32_t member = s + 1;
+    for (uint32_t i = 0; i < step.members; ++i)
+    {
+      iter(plan, member, sit, v.items[i]);
+      member = plan._steps[member].next;
+    }
+    break;
+  }
+  default:
+    it.get_basic(step.type, &v.t);
+    break;
+  }
+  ++it;
+}
+
+DynamicValue *SignaturePlan::decode(const Message &msg, ValueArena &arena) const
+{
+  Message::Private *pvt = msg._pvt.get();
+
+  if (strcmp(dbus_message_get_signature(pvt->msg), _signature.c_str()))
+    throw ErrorInvalidArgs("message signature does not match the plan");
+
+  size_t size;
+  const unsigned char *body = pvt->wire_body(size);
+
+  if (!body)
+  {
+    MessageIter it = msg.reader();
+    return decode(it, arena);
+  }
+
+  Decoder decoder(arena);
+  DynamicValue *values = decoder.values(_count);
+  size_t pos = 0;
+
+  for (uint32_t i = 0, s = 0; i < _count; ++i, s = _steps[s].next)
+    decoder.wire(*this, s, body, pos, values[i]);
+
+  return values;
+}
+
+DynamicValue *SignaturePlan::decode(MessageIter &it, ValueArena &arena) const
+{
+  Decoder decoder(arena);
+  DynamicValue *values = decoder.values(_count);
+
+  for (uint32_t i = 0, s = 0; i < _count; ++i, s = _steps[s].next)
+    decoder.iter(*this, s, it, values[i]);
+
+  return values;
+}
+
+/*
+*/
+
+struct SignaturePlan::Encoder
+{
+  static void check(const Step &step, const DynamicValue &v)
+  {
+    if (v.type != step.type)
+      throw ErrorInvalidArgs("value does not match the signature");
+  }
+
+  static void wire(const SignaturePlan &plan, uint32_t s, const DynamicValue &v, WireWriter &w);
+
+  static void iter(const SignaturePlan &plan, uint32_t s, const DynamicValue &v, MessageIter &it);
+};
+
+void SignaturePlan::Encoder::wire(const SignaturePlan &plan, uint32_t s, const DynamicValue &v, WireWriter &w)
+{
+  const Step &step = plan._steps[s];
+  const char *sig = plan._sigs.c_str() + step.sig;
+
+  check(step, v);
+
+  switch (step.type)
+  {
+  case DBUS_TYPE_BYTE:
+    w.append_byte(v.y);
+    break;
+  case DBUS_TYPE_BOOLEAN:
+    w.append_bool(v.b);
+    break;
+  case DBUS_TYPE_INT16:
+    w.append_int16(v.n);
+    break;
+  case DBUS_TYPE_UINT16:
+    w.append_uint16(v.q);
+    break;
+  case DBUS_TYPE_INT32:
+    w.append_int32(v.i);
+    break;
+  case DBUS_TYPE_UINT32:
+    w.append_uint32(v.u);
+    break;
+  case DBUS_TYPE_INT64:
+    w.append_int64(v.x);
+    break;
+  case DBUS_TYPE_UINT64:
+    w.append_uint64(v.t);
+    break;
+  case DBUS_TYPE_DOUBLE:
+    w.append_double(v.d);
+    break;
+  case DBUS_TYPE_STRING:
+    w.append_string(v.str, v.size);
+    break;
+  case DBUS_TYPE_OBJECT_PATH:
+    w.append_path(v.str, v.size);
+    break;
+  case DBUS_TYPE_SIGNATURE:
+    w.append_signature(v.str, v.size);
+    break;
+  case DBUS_TYPE_VARIANT:
+  {
+    std::unique_ptr<SignaturePlan> once;
+    const SignaturePlan &inner = variant(v.signature, once);
+
+    w.open_variant(inner._signature.c_str());
+    wire(inner, 0, v.items[0], w);
+    w.close_variant();
+    break;
+  }
+  case DBUS_TYPE_ARRAY:
+  {
+    const Step &element = plan._steps[s + 1];
+
+    if (element.size)
+    {
+      w.append_array(element.type, v.data, v.size);
+    }
+    else
+    {
+      w.open_array(sig + 1);
+      for (uint32_t i = 0; i < v.size; ++i)
+        wire(plan, s + 1, v.items[i], w);
+      w.close_array();
+    }
+    break;
+  }
+  case DBUS_TYPE_STRUCT:
+  case DBUS_TYPE_DICT_ENTRY:
+  {
+    if (step.type == DBUS_TYPE_STRUCT)
+      w.open_struct(sig);
+    else
+      w.open_dict_entry();
+
+    uint32_t member = s + 1;
+    for (uint32_t i = 0; i < step.members; ++i)
+    {
+      wire(plan, member, v.items[i], w);
+      member = plan._steps[member].next;
+    }
+
+    if (step.type == DBUS_TYPE_STRUCT)
+      w.close_struct();
+    else
+      w.close_dict_entry();
+    break;
+  }
+  default:
+    throw ErrorInvalidArgs("unix fds cannot be written by WireWriter");
+  }
+}
+
+void SignaturePlan::Encoder::iter(const SignaturePlan &plan, uint32_t s, const DynamicValue &v, MessageIter &it)
+{
+  const Step &step = plan._steps[s];
+  const char *sig = plan._sigs.c_str() + step.sig;
+
+  check(step, v);
+
+  switch (step.type)
+  {
+  case DBUS_TYPE_STRING:
+  case DBUS_TYPE_OBJECT_PATH:
+  case DBUS_TYPE_SIGNATURE:
+  {
+    const bool ok = step.type == DBUS_TYPE_STRING ? it.append_string(v.str)
+                  : step.type == DBUS_TYPE_OBJECT_PATH ? it.append_path(v.str)
+                  : it.append_signature(v.str);
+
+    if (!ok)
+      throw ErrorNoMemory("unable to append value");
+    break;
+  }
+  case DBUS_TYPE_BOOLEAN:
+    it.append_bool(v.b);
+    break;
+  case DBUS_TYPE_VARIANT:
+  {
+    std::unique_ptr<SignaturePlan> once;
+    const SignaturePlan &inner = variant(v.signature, once);
+    MessageIter vit = it.new_variant(inner._signature.c_str());
+
+    iter(inner, 0, v.items[0], vit);
+    it.close_container(vit);
+    break;
+  }
+  case DBUS_TYPE_ARRAY:
+  {
+    const Step &element = plan._steps[s + 1];
+    MessageIter ait = it.new_array(sig + 1);
+
+    if (element.size)
+    {
+      ait.append_array(element.type, v.data, v.size);
+    }
+    else
+    {
+      for (uint32_t i = 0; i < v.size; ++i)
+        iter(plan, s + 1, v.items[i], ait);
+    }
+    it.close_container(ait);
+    break;
+  }
+  case DBUS_TYPE_STRUCT:
+  case DBUS_TYPE_DICT_ENTRY:
+  {
+    MessageIter sit = step.type == DBUS_TYPE_STRUCT ? it.new_struct() : it.new_dict_entry();
+
+    uint32_t member = s + 1;
+    for (uint32_t i = 0; i < step.members; ++i)
+    {
+      iter(plan, member, v.items[i], sit);
+      member = plan._steps[member].next;
+    }
+    it.close_container(sit);
+    break;
+  }
+  default:
+  {
+    // fixed-size basic types and fds, straight from the union
+    DynamicValue copy = v;
+
+    if (!it.append_basic(step.type, &copy.t))
+      throw ErrorNoMemory("unable to append value");
+    break;
+  }
+  }
+}
+
+void SignaturePlan::encode(const DynamicValue *values, WireWriter &w) const
+{
+  for (uint32_t i = 0, s = 0; i < _count; ++i, s = _steps[s].next)
+    Encoder::wire(*this, s, values[i], w);
+}
+
+void SignaturePlan::encode(const DynamicValue *values, MessageIter &it) const
+{
+  for (uint32_t i = 0, s = 0; i < _count; ++i, s = _steps[s].next)
+    Encoder::iter(*this, s, values[i], it);
+}
@@ -246,7 +246,8 @@ void DefaultMainLoop::dispatch()
       DefaultWatches::iterator tmp = wi;
       ++tmp;
 
-      if ((*wi)->enabled() && (*wi)->_fd == fds[j].fd)
+      // a connection's read and write watches share the fd
+      if ((*wi)->enabled() && (*wi)->_fd == fds[j].fd && (*wi)->flags() == fds[j].events)
       {
         if (fds[j].revents)
         {
@@ -108,6 +108,9 @@ void InterfaceAdaptor::set_property(const std::string &name, Variant &value)
       throw ErrorInvalidSignature("property expects a different type");
 
     pti->second.value = value;
+
+    // don't keep the whole call message alive for the lifetime of the property
+    pti->second.value.detach();
     return;
   }
   throw ErrorFailed("requested property not found");
@@ -29,9 +29,11 @@
 
 #include <dbus/dbus.h>
 #include <cstdlib>
+#include <cstring>
 
 #include "internalerror.h"
 #include "message_p.h"
+#include "wire_p.h"
 
 using namespace DBus;
 
@@ -40,6 +42,8 @@ using namespace DBus;
 
 int MessageIter::type()
 {
+  if (_wire) return wire_type();
+
   return dbus_message_iter_get_arg_type((DBusMessageIter *)&_iter);
 }
 
@@ -50,11 +54,27 @@ bool MessageIter::at_end()
 
 bool MessageIter::has_next()
 {
+  if (_wire)
+  {
+    MessageIter next(*this);
+    return !(++next).at_end();
+  }
+
   return dbus_message_iter_has_next((DBusMessageIter *)&_iter);
 }
 
 MessageIter &MessageIter::operator ++()
 {
+  if (_wire)
+  {
+    if (wire_type() != DBUS_TYPE_INVALID)
+    {
+      _wpos = wire_skip_value(_wire, _wpos, _wsig);
+      _wsig = _welem ? _welem : wire_skip_signature(_wsig);
+    }
+    return (*this);
+  }
+
   dbus_message_iter_next((DBusMessageIter *)&_iter);
   return (*this);
 }
@@ -73,9 +93,29 @@ bool MessageIter::append_basic(int type_id, void *value)
 
 void MessageIter::get_basic(int type_id, void *ptr)
 {
-  if (type() != type_id)
+  if (_checked && type() != type_id)
     throw ErrorInvalidArgs("type mismatch");
 
+  if (_wire)
+  {
+    switch (type_id)
+    {
+    case DBUS_TYPE_STRING:
+    case DBUS_TYPE_OBJECT_PATH:
+      *(const char **)ptr = (const char *)_wire + wire_align(_wpos, 4) + 4;
+      break;
+    case DBUS_TYPE_SIGNATURE:
+      *(const char **)ptr = (const char *)_wire + _wpos + 1;
+      break;
+    default:
+    {
+      const size_t size = wire_fixed_size(type_id);
+      memcpy(ptr, _wire + wire_align(_wpos, size), size);
+    }
+    }
+    return;
+  }
+
   dbus_message_iter_get_basic((DBusMessageIter *)_iter, ptr);
 }
 
@@ -190,6 +230,10 @@ bool MessageIter::append_double(double d)
 
 bool MessageIter::append_string(const char *chars)
 {
+  // libdbus checks again, but would abort the process on invalid input
+  if (_validate && !wire_valid_utf8(chars, strlen(chars)))
+    throw ErrorInvalidArgs("invalid UTF-8 string");
+
   return append_basic(DBUS_TYPE_STRING, &chars);
 }
 
@@ -202,6 +246,9 @@ const char *MessageIter::get_string()
 
 bool MessageIter::append_path(const char *chars)
 {
+  if (_validate && !wire_valid_path(chars, strlen(chars)))
+    throw ErrorInvalidArgs("invalid object path");
+
   return append_basic(DBUS_TYPE_OBJECT_PATH, &chars);
 }
 
@@ -214,6 +261,9 @@ const char *MessageIter::get_path()
 
 bool MessageIter::append_signature(const char *chars)
 {
+  if (_validate && !wire_valid_signature(chars, strlen(chars)))
+    throw ErrorInvalidArgs("invalid signature");
+
   return append_basic(DBUS_TYPE_SIGNATURE, &chars);
 }
 
@@ -227,12 +277,61 @@ const char *MessageIter::get_signature()
 MessageIter MessageIter::recurse()
 {
   MessageIter iter(msg());
+  // the types inside a variant are not part of the verified signature
+  iter._checked = _checked || type() == DBUS_TYPE_VARIANT;
+
+  if (_wire)
+  {
+    iter._wire = _wire;
+    iter._welem = 0;
+    iter._wend = _wend;
+
+    switch (*_wsig)
+    {
+    case DBUS_TYPE_ARRAY:
+    {
+      const size_t pos = wire_align(_wpos, 4);
+      uint32_t length;
+
+      memcpy(&length, _wire + pos, sizeof(length));
+      iter._wsig = iter._welem = _wsig + 1;
+      iter._wpos = wire_align(pos + 4, wire_alignment(_wsig[1]));
+      iter._wend = iter._wpos + length;
+      break;
+    }
+    case DBUS_TYPE_VARIANT:
+      iter._wsig = (const char *)_wire + _wpos + 1;
+      iter._wpos = _wpos + 1 + _wire[_wpos] + 1;
+      break;
+    case DBUS_STRUCT_BEGIN_CHAR:
+    case DBUS_DICT_ENTRY_BEGIN_CHAR:
+      iter._wsig = _wsig + 1;
+      iter._wpos = wire_align(_wpos, 8);
+      break;
+    default:
+      iter._wsig = "";
+      iter._wpos = _wpos;
+    }
+    return iter;
+  }
+
   dbus_message_iter_recurse((DBusMessageIter *)&_iter, (DBusMessageIter *) & (iter._iter));
   return iter;
 }
 
 char *MessageIter::signature() const
 {
+  if (_wire)
+  {
+    // inside an array this is the element signature, even when empty
+    const size_t length = _welem || wire_type() != DBUS_TYPE_INVALID ? wire_skip_signature(_wsig) - _wsig : 0;
+    char *sig = (char *)malloc(length + 1);
+
+    memcpy(sig, _wsig, length);
+    sig[length] = 0;
+    return sig;
+  }
+
   return dbus_message_iter_get_signature((DBusMessageIter *)&_iter);
 }
 
@@ -243,11 +342,31 @@ bool MessageIter::append_array(char type, const void *ptr, size_t length)
 
 int MessageIter::array_type()
 {
+  if (_wire)
+  {
+    switch (_wsig[1])
+    {
+    case DBUS_STRUCT_BEGIN_CHAR:
+      return DBUS_TYPE_STRUCT;
+    case DBUS_DICT_ENTRY_BEGIN_CHAR:
+      return DBUS_TYPE_DICT_ENTRY;
+    default:
+      return _wsig[1];
+    }
+  }
+
   return dbus_message_iter_get_element_type((DBusMessageIter *)&_iter);
 }
 
 int MessageIter::get_array(void *ptr)
 {
+  if (_wire)
+  {
+    // like libdbus, this iterator has been recursed into the array
+    *(const void **)ptr = _wire + _wpos;
+    return (_wend - _wpos) / wire_fixed_size(*_wsig);
+  }
+
   int length;
   dbus_message_iter_get_fixed_array((DBusMessageIter *)&_iter, ptr, &length);
   return length;
@@ -255,17 +374,48 @@ int MessageIter::get_array(void *ptr)
 
 bool MessageIter::is_array()
 {
-  return dbus_message_iter_get_arg_type((DBusMessageIter *)&_iter) == DBUS_TYPE_ARRAY;
+  return type() == DBUS_TYPE_ARRAY;
 }
 
 bool MessageIter::is_dict()
 {
-  return is_array() && dbus_message_iter_get_element_type((DBusMessageIter *)_iter) == DBUS_TYPE_DICT_ENTRY;
+  return is_array() && array_type() == DBUS_TYPE_DICT_ENTRY;
+}
+
+int MessageIter::element_count()
+{
+  if (_wire)
+  {
+    MessageIter ait = recurse();
+    const size_t size = wire_fixed_size(_wsig[1]);
+
+    if (size)
+      return (ait._wend - ait._wpos) / size;
+
+    int count = 0;
+
+    for (; !ait.at_end(); ++ait)
+      ++count;
+
+    return count;
+  }
+
+#if DBUS_VERSION >= 0x010910 // dbus_message_iter_get_element_count() is new in 1.9.16
+  return dbus_message_iter_get_element_count((DBusMessageIter *)&_iter);
+#else
+  int count = 0;
+
+  for (MessageIter ait = recurse(); !ait.at_end(); ++ait)
+    ++count;
+
+  return count;
+#endif
 }
 
 MessageIter MessageIter::new_array(const char *sig)
 {
   MessageIter arr(msg());
+  arr._validate = _validate;
   dbus_message_iter_open_container(
     (DBusMessageIter *)&_iter, DBUS_TYPE_ARRAY, sig, (DBusMessageIter *) & (arr._iter)
   );
@@ -275,6 +425,7 @@ MessageIter MessageIter::new_array(const char *sig)
 MessageIter MessageIter::new_variant(const char *sig)
 {
   MessageIter var(msg());
+  var._validate = _validate;
   dbus_message_iter_open_container(
     (DBusMessageIter *)_iter, DBUS_TYPE_VARIANT, sig, (DBusMessageIter *) & (var._iter)
   );
@@ -284,6 +435,7 @@ MessageIter MessageIter::new_variant(const char *sig)
 MessageIter MessageIter::new_struct()
 {
   MessageIter stu(msg());
+  stu._validate = _validate;
   dbus_message_iter_open_container(
     (DBusMessageIter *)_iter, DBUS_TYPE_STRUCT, NULL, (DBusMessageIter *) & (stu._iter)
   );
@@ -293,6 +445,7 @@ MessageIter MessageIter::new_struct()
 MessageIter MessageIter::new_dict_entry()
 {
   MessageIter ent(msg());
+  ent._validate = _validate;
   dbus_message_iter_open_container(
     (DBusMessageIter *)_iter, DBUS_TYPE_DICT_ENTRY, NULL, (DBusMessageIter *) & (ent._iter)
   );
@@ -304,6 +457,22 @@ void MessageIter::close_container(MessageIter &container)
   dbus_message_iter_close_container((DBusMessageIter *)&_iter, (DBusMessageIter *) & (container._iter));
 }
 
+int MessageIter::wire_type() const
+{
+  if (_welem ? _wpos >= _wend : (*_wsig == 0 || *_wsig == DBUS_STRUCT_END_CHAR || *_wsig == DBUS_DICT_ENTRY_END_CHAR))
+    return DBUS_TYPE_INVALID;
+
+  switch (*_wsig)
+  {
+  case DBUS_STRUCT_BEGIN_CHAR:
+    return DBUS_TYPE_STRUCT;
+  case DBUS_DICT_ENTRY_BEGIN_CHAR:
+    return DBUS_TYPE_DICT_ENTRY;
+  default:
+    return *_wsig;
+  }
+}
+
 static bool is_basic_type(int typecode)
 {
   switch (typecode)
@@ -338,6 +507,21 @@ void MessageIter::copy_data(MessageIter &to)
       from.get_basic(from.type(), &value);
       to.append_basic(from.type(), &value);
     }
+    else if (from.type() == DBUS_TYPE_ARRAY && wire_fixed_size(from.array_type()))
+    {
+      // one block instead of a libdbus call per element
+      const char sig[] = { (char)from.array_type(), '\0' };
+
+      debug_log("copying fixed array: a%c", sig[0]);
+
+      MessageIter from_array = from.recurse();
+      MessageIter to_array = to.new_array(sig);
+      const void *ptr;
+      const int length = from_array.get_array(&ptr);
+
+      to_array.append_array(sig[0], ptr, length);
+      to.close_container(to_array);
+    }
     else
     {
       MessageIter from_container = from.recurse();
@@ -350,7 +534,7 @@ void MessageIter::copy_data(MessageIter &to)
       (
         (DBusMessageIter *) & (to._iter),
         from.type(),
-        from.type() == DBUS_TYPE_VARIANT ? NULL : sig,
+        from.type() == DBUS_TYPE_ARRAY || from.type() == DBUS_TYPE_VARIANT ? sig : NULL,
         (DBusMessageIter *) & (to_container._iter)
       );
 
@@ -381,26 +565,124 @@ Message::Message(const Message &m)
   dbus_message_ref(_pvt->msg);
 }
 
+Message::Message(Message &&m)
+  : _pvt(std::move(m._pvt))
+{
+}
+
 Message::~Message()
 {
-  dbus_message_unref(_pvt->msg);
+  if (_pvt.get()) dbus_message_unref(_pvt->msg);
 }
 
 Message &Message::operator = (const Message &m)
 {
   if (&m != this)
   {
-    dbus_message_unref(_pvt->msg);
+    if (_pvt.get()) dbus_message_unref(_pvt->msg);
     _pvt = m._pvt;
     dbus_message_ref(_pvt->msg);
   }
   return *this;
 }
 
+Message &Message::operator = (Message &&m)
+{
+  if (&m != this)
+  {
+    if (_pvt.get()) dbus_message_unref(_pvt->msg);
+    _pvt = std::move(m._pvt);
+  }
+  return *this;
+}
+
+/* offset of the body in data, a marshalled message, and its length; the
+ * header stays in the sender's byte order
+ */
+static size_t wire_body_at(const char *data, size_t &size)
+{
+  const unsigned char *head = (const unsigned char *)data;
+  uint32_t body_length, fields_length;
+
+  memcpy(&body_length, head + 4, sizeof(body_length));
+  memcpy(&fields_length, head + 12, sizeof(fields_length));
+
+  if (head[0] != host_byte_order())
+  {
+    body_length = __builtin_bswap32(body_length);
+    fields_length = __builtin_bswap32(fields_length);
+  }
+
+  size = body_length;
+  return wire_align(16 + fields_length, 8);
+}
+
+/* converts the body of data, the marshalled form of msg, to host order
+ */
+static void wire_to_host(char *data, DBusMessage *msg)
+{
+  if (data[0] == host_byte_order())
+    return;
+
+  size_t size;
+  const size_t body = wire_body_at(data, size);
+
+  wire_swap_body((unsigned char *)data + body, size, dbus_message_get_signature(msg));
+}
+
+const unsigned char *Message::Private::wire_body(size_t &size)
+{
+  char *data = __atomic_load_n(&wire, __ATOMIC_ACQUIRE);
+
+  if (!data)
+  {
+    // fds travel out of band, only libdbus can map the indices back; they
+    // may hide in variants, so the signature alone does not tell
+    if (dbus_message_contains_unix_fds(msg))
+      return 0;
+
+    int length;
+
+    if (!dbus_message_marshal(msg, &data, &length))
+      return 0;
+
+    wire_to_host(data, msg);
+
+    // another reader may have published its copy meanwhile
+    char *none = 0;
+
+    if (!__atomic_compare_exchange_n(&wire, &none, data, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      dbus_free(data);
+      data = none;
+    }
+  }
+
+  return (const unsigned char *)data + wire_body_at(data, size);
+}
+
+void Message::Private::adopt_wire(char *data)
+{
+  wire_to_host(data, msg);
+
+  drop_wire();
+  wire = data;
+}
+
 Message Message::copy()
 {
   Private *pvt = new Private(dbus_message_copy(_pvt->msg));
-  return Message(pvt);
+  return Message(pvt, false);
+}
+
+Message Message::demarshal(const char *data, size_t size)
+{
+  InternalError e;
+  DBusMessage *msg = dbus_message_demarshal(data, size, e);
+
+  if (e) throw Error(e);
+
+  return Message(new Private(msg), false);
 }
 
 bool Message::append(int first_type, ...)
@@ -408,6 +690,7 @@ bool Message::append(int first_type, ...)
   va_list vl;
   va_start(vl, first_type);
 
+  _pvt->drop_wire();
   bool b = dbus_message_append_args_valist(_pvt->msg, first_type, vl);
 
   va_end(vl);
@@ -472,6 +755,7 @@ bool Message::is_signal(const char *interface, const char *member) const
 MessageIter Message::writer()
 {
   MessageIter iter(*this);
+  _pvt->drop_wire();
   dbus_message_iter_init_append(_pvt->msg, (DBusMessageIter *) & (iter._iter));
   return iter;
 }
@@ -483,6 +767,85 @@ MessageIter Message::reader() const
   return iter;
 }
 
+/* arrays whose elements are not fixed-size cost libdbus a call per value,
+ * which outweighs marshalling the body once to read it in place
+ */
+static bool in_place(const char *signature)
+{
+  for (const char *sig = strchr(signature, DBUS_TYPE_ARRAY); sig; sig = strchr(sig + 1, DBUS_TYPE_ARRAY))
+  {
+    if (!wire_fixed_size(sig[1]))
+      return true;
+  }
+  return false;
+}
+
+/* below this many bytes of arrays, marshalling a body costs unchecked_reader()
+ * more than reading it in place saves (see test/benchmark/reader.cpp)
+ */
+static const size_t min_wire_body = 64;
+
+/* bytes taken by the top-level arrays of the body of msg, each looked up in
+ * its length field rather than walked
+ */
+static size_t array_bytes(DBusMessage *msg)
+{
+  DBusMessageIter it;
+  size_t bytes = 0;
+
+  if (!dbus_message_iter_init(msg, &it))
+    return 0;
+
+  // deprecated as a mere wire detail, which is all that is wanted here
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+  do
+  {
+    if (dbus_message_iter_get_arg_type(&it) == DBUS_TYPE_ARRAY)
+    {
+      DBusMessageIter ait;
+
+      dbus_message_iter_recurse(&it, &ait);
+      bytes += dbus_message_iter_get_array_len(&ait);
+    }
+  }
+  while (dbus_message_iter_next(&it));
+#pragma GCC diagnostic pop
+
+  return bytes;
+}
+
+MessageIter Message::unchecked_reader(const char *signature) const
+{
+  if (!dbus_message_has_signature(_pvt->msg, signature))
+    throw ErrorInvalidArgs("signature mismatch");
+
+  // marshalling a copy only pays off for bodies of some size
+  const bool wire = in_place(signature)
+                    && (_pvt->has_wire() || array_bytes(_pvt->msg) >= min_wire_body);
+
+  MessageIter iter = wire ? wire_reader() : reader();
+  iter._checked = false;
+  return iter;
+}
+
+MessageIter Message::wire_reader() const
+{
+  size_t size;
+  const unsigned char *body = _pvt->wire_body(size);
+
+  if (!body)
+    return reader();
+
+  MessageIter iter(const_cast<Message &>(*this));
+  iter._wire = body;
+  iter._wsig = dbus_message_get_signature(_pvt->msg);
+  iter._welem = 0;
+  iter._wpos = 0;
+  iter._wend = size;
+  return iter;
+}
+
 /*
 */
 
@@ -41,11 +41,44 @@ struct DXXAPILOCAL Message::Private
 {
   DBusMessage *msg;
 
-  Private() : msg(0)
+  /* marshalled copy of the message read by wire_reader(), 0 until needed;
+   * set at most once while the message is shared, see wire_body()
+   */
+  char *wire;
+
+  Private() : msg(0), wire(0)
   {}
 
-  Private(DBusMessage *m) : msg(m)
+  Private(DBusMessage *m) : msg(m), wire(0)
   {}
+
+  ~Private()
+  {
+    drop_wire();
+  }
+
+  void drop_wire()
+  {
+    dbus_free(wire);
+    wire = 0;
+  }
+
+  bool has_wire() const
+  {
+    return __atomic_load_n(&wire, __ATOMIC_ACQUIRE) != 0;
+  }
+
+  /* the body in the wire buffer, in host order, and its size; marshals
+   * msg into the buffer first if needed, which const readers in several
+   * threads may do at once. 0 for bodies with unix fds or on lack of
+   * memory
+   */
+  const unsigned char *wire_body(size_t &size);
+
+  /* takes over data, the marshalled form of msg allocated with
+   * dbus_malloc(), as the wire buffer; the message is not shared yet
+   */
+  void adopt_wire(char *data);
 };
 
 } /* namespace DBus */
@@ -74,13 +74,15 @@ void ObjectAdaptor::Private::unregister_function_stub(DBusConnection *conn, void
   //TODO: what do we have to do here ?
 }
 
-DBusHandlerResult ObjectAdaptor::Private::message_function_stub(DBusConnection *, DBusMessage *dmsg, void *data)
+DBusHandlerResult ObjectAdaptor::Private::message_function_stub(DBusConnection *conn, DBusMessage *dmsg, void *data)
 {
   ObjectAdaptor *o = static_cast<ObjectAdaptor *>(data);
 
   if (o)
   {
-    Message msg(new Message::Private(dmsg));
+    // native connections dispatch without a DBusConnection
+    Message *const dispatching = conn ? NULL : o->conn()._pvt->dispatching;
+    Message msg = dispatching ? *dispatching : Message(new Message::Private(dmsg));
 
     debug_log("in object %s", o->path().c_str());
     debug_log(" got message #%d from %s to %s",
@@ -171,7 +173,7 @@ void ObjectAdaptor::register_obj()
 {
   debug_log("registering local object %s", path().c_str());
 
-  if (!dbus_connection_register_object_path(conn()._pvt->conn, path().c_str(), &_vtable, this))
+  if (!conn()._pvt->register_object_path(path().c_str(), &_vtable, this))
   {
     throw ErrorNoMemory("unable to register object path");
   }
@@ -185,7 +187,7 @@ void ObjectAdaptor::unregister_obj(bool)
 
   debug_log("unregistering local object %s", path().c_str());
 
-  dbus_connection_unregister_object_path(conn()._pvt->conn, path().c_str());
+  conn()._pvt->unregister_object_path(path().c_str());
 }
 
 void ObjectAdaptor::_emit_signal(SignalMessage &sig)
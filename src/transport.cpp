@@ -0,0 +1,1104 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus-c++/debug.h>
+#include <dbus-c++/error.h>
+
+#include <dbus/dbus.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <stddef.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "internalerror.h"
+
+#include "message_p.h"
+#include "transport_p.h"
+
+using namespace DBus;
+
+/* the most a single recv() asks for, and what the buffer grows by
+ */
+static const size_t read_size = 65536;
+
+static const int default_reply_timeout = 25000; // libdbus's default
+static const long default_max_received_size = 63 * 1024 * 1024; // likewise
+static const int shared_poll_slice = 10;      // ms, see fill()
+static const unsigned int starvation_limit = 16; // see NativeTransport::next()
+static const int prioritized_sndbuf = 16384;
+
+static int64_t monotonic_ms()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int64_t monotonic_us()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static std::string unescape(const std::string &value)
+{
+  std::string out;
+
+  for (size_t i = 0; i < value.size(); ++i)
+  {
+    if (value[i] == '%' && i + 2 < value.size())
+    {
+      out += (char)strtol(value.substr(i + 1, 2).c_str(), NULL, 16);
+      i += 2;
+    }
+    else
+      out += value[i];
+  }
+  return out;
+}
+
+/* socket connected to a single "unix:path=..." or "unix:abstract=..."
+ * address entry, -1 if the entry is of another kind or refuses
+ */
+static int connect_entry(const std::string &entry, bool &unix_entry)
+{
+  unix_entry = false;
+
+  if (entry.compare(0, 5, "unix:"))
+    return -1;
+
+  std::string path;
+  bool abstract = false;
+  size_t pos = 5;
+
+  while (pos < entry.size())
+  {
+    size_t comma = entry.find(',', pos);
+    if (comma == std::string::npos)
+      comma = entry.size();
+
+    const std::string pair = entry.substr(pos, comma - pos);
+    const size_t eq = pair.find('=');
+
+    if (eq != std::string::npos)
+    {
+      const std::string key = pair.substr(0, eq);
+
+      if (key == "path" || key == "abstract")
+      {
+        path = unescape(pair.substr(eq + 1));
+        abstract = key == "abstract";
+      }
+    }
+    pos = comma + 1;
+  }
+
+  struct sockaddr_un sa;
+
+  if (path.empty() || path.size() + 1 >= sizeof(sa.sun_path))
+    return -1;
+
+  unix_entry = true;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  memcpy(sa.sun_path + abstract, path.data(), path.size());
+
+  const socklen_t length = offsetof(struct sockaddr_un, sun_path) + abstract + path.size() + !abstract;
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (fd < 0)
+    return -1;
+
+  if (connect(fd, (struct sockaddr *)&sa, length) < 0)
+  {
+    const int saved = errno;
+    ::close(fd);
+    errno = saved;
+    return -1;
+  }
+  return fd;
+}
+
+NativeTransport::NativeTransport(const char *address)
+  : fd(-1), broken(false), serial(0), buffer(0), begin(0), end(0), capacity(0), wanted(0), readers(0),
+    received(0), max_received_size(default_max_received_size), max_message_size(DBUS_MAXIMUM_MESSAGE_LENGTH),
+    partial_done(0), queued(0), prioritized(false), default_sndbuf(0), corked_since(0), cork_budget(0), cork_bytes(0)
+{
+  for (int l = 0; l < lanes; ++l)
+    passed[l] = 0;
+  partial.data = NULL;
+
+  watch.fd = -1;
+  watch.flags = DBUS_WATCH_READABLE;
+  watch.enabled = false;
+  watch.owner = 0;
+  watch.watch = 0;
+
+  write_watch = watch;
+  write_watch.flags = DBUS_WATCH_WRITABLE;
+
+  // granularity of the cork budget, the dispatcher counts milliseconds
+  cork_timeout.interval = 1;
+  cork_timeout.enabled = false;
+  cork_timeout.owner = 0;
+  cork_timeout.timeout = 0;
+
+  wakeup[0] = wakeup[1] = -1;
+  wakeup_watch = watch;
+
+  const std::string addresses(address ? address : "");
+  bool any_unix = false;
+  int error = 0;
+  size_t pos = 0;
+
+  while (fd < 0 && pos <= addresses.size())
+  {
+    size_t semicolon = addresses.find(';', pos);
+    if (semicolon == std::string::npos)
+      semicolon = addresses.size();
+
+    bool unix_entry;
+
+    fd = connect_entry(addresses.substr(pos, semicolon - pos), unix_entry);
+    if (unix_entry && fd < 0)
+      error = errno;
+    any_unix = any_unix || unix_entry;
+    pos = semicolon + 1;
+  }
+
+  if (!any_unix)
+    throw ErrorNotSupported("the native transport only connects to unix: addresses");
+  if (fd < 0)
+    throw ErrorNoServer(strerror(error));
+
+  try
+  {
+    authenticate();
+  }
+  catch (...)
+  {
+    ::close(fd);
+    throw;
+  }
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  if (pipe(wakeup) < 0)
+  {
+    ::close(fd);
+    throw ErrorLimitsExceeded(strerror(errno));
+  }
+  fcntl(wakeup[0], F_SETFL, O_NONBLOCK);
+  fcntl(wakeup[1], F_SETFL, O_NONBLOCK);
+
+  watch.fd = fd;
+  watch.enabled = true;
+  write_watch.fd = fd;
+  wakeup_watch.fd = wakeup[0];
+  wakeup_watch.enabled = true;
+
+  debug_log("native transport connected to %s, server guid %s", address, guid.c_str());
+}
+
+NativeTransport::~NativeTransport()
+{
+  if (fd >= 0)
+    ::close(fd);
+  cork_timeout.timeout = NULL;
+  write_watch.watch = NULL;
+  drop_queue();
+
+  if (wakeup[0] >= 0)
+  {
+    ::close(wakeup[0]);
+    ::close(wakeup[1]);
+  }
+  dbus_free(buffer);
+}
+
+std::string NativeTransport::bus_address(DBusBusType type)
+{
+  const char *address = NULL;
+
+  switch (type)
+  {
+  case DBUS_BUS_SESSION:
+    address = getenv("DBUS_SESSION_BUS_ADDRESS");
+    break;
+  case DBUS_BUS_SYSTEM:
+    address = getenv("DBUS_SYSTEM_BUS_ADDRESS");
+    if (!address)
+      address = "unix:path=/var/run/dbus/system_bus_socket";
+    break;
+  case DBUS_BUS_STARTER:
+    address = getenv("DBUS_STARTER_ADDRESS");
+    break;
+  }
+
+  if (!address)
+    throw ErrorBadAddress("bus address not set in the environment");
+
+  return address;
+}
+
+void NativeTransport::authenticate()
+{
+  static const char hex[] = "0123456789abcdef";
+
+  char uid[32];
+  snprintf(uid, sizeof(uid), "%lu", (unsigned long)geteuid());
+
+  // the credentials byte, then the uid as hex-encoded ASCII
+  std::string request(1, '\0');
+  request += "AUTH EXTERNAL ";
+  for (const char *c = uid; *c; ++c)
+  {
+    request += hex[(unsigned char)*c >> 4];
+    request += hex[*c & 0xf];
+  }
+  request += "\r\n";
+
+  if (!write_all(request.data(), request.size()))
+    throw ErrorIOError(strerror(errno));
+
+  std::string line;
+  char chunk[256];
+
+  while (line.find("\r\n") == std::string::npos)
+  {
+    const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      throw ErrorAuthFailed("connection closed during authentication");
+
+    line.append(chunk, n);
+    if (line.size() > 16384)
+      throw ErrorAuthFailed("authentication reply too long");
+  }
+  line.erase(line.find("\r\n"));
+
+  if (line.compare(0, 3, "OK "))
+    throw ErrorAuthFailed(("EXTERNAL authentication rejected: " + line).c_str());
+
+  guid = line.substr(3);
+
+  static const char begin_line[] = "BEGIN\r\n";
+
+  if (!write_all(begin_line, sizeof(begin_line) - 1))
+    throw ErrorIOError(strerror(errno));
+}
+
+bool NativeTransport::write_all(const char *data, size_t length)
+{
+  struct iovec iov = { const_cast<char *>(data), length };
+
+  return write_all(&iov, 1);
+}
+
+/* consumes iov as it goes
+ */
+bool NativeTransport::write_all(struct iovec *iov, int count)
+{
+  while (count)
+  {
+    if (!iov->iov_len)
+    {
+      ++iov;
+      --count;
+      continue;
+    }
+
+    struct msghdr m;
+
+    memset(&m, 0, sizeof(m));
+    m.msg_iov = iov;
+    m.msg_iovlen = count < IOV_MAX ? count : IOV_MAX;
+
+    ssize_t n = sendmsg(fd, &m, MSG_NOSIGNAL);
+
+    if (n > 0)
+    {
+      for (; count && (size_t)n >= iov->iov_len; ++iov, --count)
+        n -= iov->iov_len;
+
+      if (n)
+      {
+        iov->iov_base = (char *)iov->iov_base + n;
+        iov->iov_len -= n;
+      }
+    }
+    else if (n < 0 && errno == EINTR)
+      continue;
+    else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      struct pollfd p = { fd, POLLOUT, 0 };
+      poll(&p, 1, -1);
+    }
+    else
+      return false;
+  }
+  return true;
+}
+
+/* called with write_mutex held
+ */
+bool NativeTransport::prepare(DBusMessage *msg, char **data, int *length)
+{
+  // fds travel as ancillary data, which this transport does not negotiate;
+  // they may hide in variants, so the signature alone does not tell
+  if (fd < 0 || dbus_message_contains_unix_fds(msg))
+    return false;
+
+  if (!dbus_message_get_serial(msg))
+    dbus_message_set_serial(msg, next_serial());
+  dbus_message_lock(msg);
+
+  return dbus_message_marshal(msg, data, length);
+}
+
+NativeTransport::Lane NativeTransport::lane(DBusMessage *msg) const
+{
+  if (!prioritized)
+    return CallLane;
+
+  switch (dbus_message_get_type(msg))
+  {
+  case DBUS_MESSAGE_TYPE_METHOD_RETURN:
+  case DBUS_MESSAGE_TYPE_ERROR:
+    return ReplyLane;
+  case DBUS_MESSAGE_TYPE_SIGNAL:
+    return SignalLane;
+  default:
+    return CallLane;
+  }
+}
+
+void NativeTransport::enqueue(const NativeFrame &f)
+{
+  if (!queued)
+    corked_since = cork_budget ? monotonic_us() : 0;
+
+  queue[f.lane].push_back(f);
+  queued += f.size;
+}
+
+/* takes the frame to write next: the oldest of the first lane holding any,
+ * unless a later lane has let starvation_limit frames pass
+ */
+bool NativeTransport::next(NativeFrame &f)
+{
+  int pick = -1;
+
+  for (int l = lanes - 1; l >= 0; --l)
+  {
+    if (queue[l].empty())
+      continue;
+
+    pick = l;
+    if (passed[l] >= starvation_limit)
+      break;
+  }
+
+  if (pick < 0)
+    return false;
+
+  f = queue[pick].front();
+  queue[pick].pop_front();
+
+  f.passing = 0;
+  for (int l = pick + 1; l < lanes; ++l)
+  {
+    if (!queue[l].empty())
+      f.passing |= 1u << l;
+  }
+  count_passing(f);
+  return true;
+}
+
+/* resets the count of f's lane and counts f against those it passed
+ */
+void NativeTransport::count_passing(const NativeFrame &f)
+{
+  passed[f.lane] = 0;
+  for (int l = f.lane + 1; l < lanes; ++l)
+  {
+    if (f.passing & (1u << l))
+      ++passed[l];
+  }
+}
+
+/* writes queued frames in the order next() takes them until the socket is
+ * full or, if block is set, until nothing from the lanes up to upto is left,
+ * waiting for room without write_mutex so that other threads can queue
+ * meanwhile; called with write_mutex held, false if the socket failed
+ */
+bool NativeTransport::write_queue(Lane upto, bool block)
+{
+  while (fd >= 0)
+  {
+    size_t frames = partial.data ? 1 : 0;
+
+    for (int l = 0; l < lanes; ++l)
+      frames += queue[l].size();
+
+    const int most = frames < IOV_MAX ? frames : IOV_MAX;
+
+    if (!most)
+      break;
+
+    if (write_iov.size() < (size_t)most)
+    {
+      write_iov.resize(most);
+      write_batch.resize(most);
+    }
+
+    struct iovec *const iov = &write_iov[0];
+    NativeFrame *const batch = &write_batch[0];
+    unsigned int passed_before[lanes];
+    int n = 0;
+
+    memcpy(passed_before, passed, sizeof(passed));
+
+    if (partial.data)
+    {
+      batch[0] = partial;
+      iov[0].iov_base = partial.data + partial_done;
+      iov[0].iov_len = partial.size - partial_done;
+      partial.data = NULL;
+      n = 1;
+    }
+
+    const int first_taken = n;
+
+    for (; n < most && next(batch[n]); ++n)
+    {
+      iov[n].iov_base = batch[n].data;
+      iov[n].iov_len = batch[n].size;
+    }
+
+    struct msghdr m;
+
+    memset(&m, 0, sizeof(m));
+    m.msg_iov = iov;
+    m.msg_iovlen = n;
+
+    const ssize_t w = sendmsg(fd, &m, MSG_NOSIGNAL);
+    const int error = w < 0 ? errno : 0;
+    size_t left = w > 0 ? w : 0;
+    int i = 0;
+
+    for (; i < n && left >= iov[i].iov_len; ++i)
+    {
+      left -= iov[i].iov_len;
+      queued -= iov[i].iov_len;
+      dbus_free(batch[i].data);
+    }
+
+    // a frame begun has to be finished before any other
+    if (i < n && (left || iov[i].iov_base != batch[i].data))
+    {
+      partial = batch[i];
+      partial_done = (char *)iov[i].iov_base - batch[i].data + left;
+      queued -= left;
+      ++i;
+    }
+
+    for (int j = n - 1; j >= i; --j)
+      queue[batch[j].lane].push_front(batch[j]);
+
+    // only frames the socket took count as having passed the other lanes
+    if (i < n)
+    {
+      memcpy(passed, passed_before, sizeof(passed));
+      for (int j = first_taken; j < i; ++j)
+        count_passing(batch[j]);
+    }
+
+    if (error == EINTR || (!error && i == n && !partial.data))
+      continue;
+
+    if (error && error != EAGAIN && error != EWOULDBLOCK)
+    {
+      debug_log("native transport: write failed, %s", strerror(error));
+      drop_queue();
+
+      // disconnected() needs read_mutex; the reader sees the end instead
+      shutdown(fd, SHUT_RDWR);
+      broken = true;
+      return false;
+    }
+
+    bool waiting = partial.data && partial.lane <= upto;
+
+    for (int l = 0; l <= upto && !waiting; ++l)
+      waiting = !queue[l].empty();
+
+    if (!block || !waiting)
+      break;
+
+    /* the wakeup pipe gets us out should the socket go meanwhile; it stays
+     * readable until the dispatcher drains it, so then the socket alone
+     */
+    struct pollfd p[2] = { { fd, POLLOUT, 0 }, { wakeup[0], POLLIN, 0 } };
+
+    write_mutex.unlock();
+    if (poll(p, 2, -1) > 0 && !p[0].revents)
+      poll(p, 1, shared_poll_slice);
+    write_mutex.lock();
+  }
+
+  watch_queue(cork_budget && queued, queued);
+  return fd >= 0;
+}
+
+/* enables the cork timeout and the write watch as asked, waking the
+ * dispatcher up if either was off; called with write_mutex held
+ */
+void NativeTransport::watch_queue(bool timer, bool writer)
+{
+  bool wake_dispatcher = false;
+
+  if (cork_timeout.enabled != timer)
+  {
+    cork_timeout.enabled = timer;
+    wake_dispatcher = timer;
+    if (cork_timeout.timeout)
+      cork_timeout.timeout->toggle();
+  }
+
+  if (write_watch.enabled != writer)
+  {
+    write_watch.enabled = writer;
+    wake_dispatcher = wake_dispatcher || writer;
+    if (write_watch.watch)
+      write_watch.watch->toggle();
+  }
+
+  if (wake_dispatcher)
+    wake();
+}
+
+void NativeTransport::drop_queue()
+{
+  if (partial.data)
+    dbus_free(partial.data);
+  partial.data = NULL;
+
+  for (int l = 0; l < lanes; ++l)
+  {
+    for (std::deque<NativeFrame>::iterator f = queue[l].begin(); f != queue[l].end(); ++f)
+      dbus_free(f->data);
+    queue[l].clear();
+    passed[l] = 0;
+  }
+  queued = 0;
+
+  watch_queue(false, false);
+}
+
+bool NativeTransport::send(DBusMessage *msg, dbus_uint32_t *serial_out, bool cork, bool block)
+{
+  write_mutex.lock();
+
+  char *data;
+  int length;
+  bool ok = prepare(msg, &data, &length);
+
+  if (ok)
+  {
+    const NativeFrame f = { data, (size_t)length, lane(msg), 0 };
+
+    enqueue(f);
+
+    if (!cork || !cork_budget || queued >= cork_bytes || monotonic_us() - corked_since >= cork_budget)
+      ok = write_queue((Lane)f.lane, block);
+    else
+      watch_queue(true, write_watch.enabled);
+  }
+
+  write_mutex.unlock();
+
+  if (ok && serial_out)
+    *serial_out = dbus_message_get_serial(msg);
+  return ok;
+}
+
+size_t NativeTransport::send_batch(DBusMessage *const *msgs, size_t count, dbus_uint32_t *serials)
+{
+  size_t sent = 0;
+  Lane upto = ReplyLane;
+
+  write_mutex.lock();
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    char *data;
+    int length;
+
+    serials[i] = 0;
+    if (!prepare(msgs[i], &data, &length))
+      continue;
+
+    const NativeFrame f = { data, (size_t)length, lane(msgs[i]), 0 };
+
+    enqueue(f);
+    if (f.lane > upto)
+      upto = (Lane)f.lane;
+    serials[i] = dbus_message_get_serial(msgs[i]);
+    ++sent;
+  }
+
+  const bool ok = write_queue(upto, true);
+
+  write_mutex.unlock();
+
+  if (!ok)
+  {
+    // some may have gone out before the socket failed, but not all
+    for (size_t i = 0; i < count; ++i)
+      serials[i] = 0;
+    return 0;
+  }
+  return sent;
+}
+
+Message NativeTransport::send_blocking(DBusMessage *msg, int timeout)
+{
+  if (timeout < 0)
+    timeout = default_reply_timeout;
+
+  // the serial has to be awaited before the reply can possibly arrive
+  write_mutex.lock();
+  if (!dbus_message_get_serial(msg))
+    dbus_message_set_serial(msg, next_serial());
+  const dbus_uint32_t s = dbus_message_get_serial(msg);
+  write_mutex.unlock();
+
+  read_mutex.lock();
+  awaited.insert(s);
+  read_mutex.unlock();
+
+  const bool sent = send(msg, NULL, false, true);
+  const int64_t deadline = monotonic_ms() + timeout;
+
+  read_mutex.lock();
+
+  for (;;)
+  {
+    std::map<dbus_uint32_t, Message>::iterator r = replies.find(s);
+
+    if (r != replies.end())
+    {
+      Message reply = r->second;
+
+      replies.erase(r);
+      awaited.erase(s);
+      read_mutex.unlock();
+
+      if (reply.is_error())
+        throw Error(reply);
+
+      return reply;
+    }
+
+    const int remaining = deadline - monotonic_ms();
+
+    if (!sent || fd < 0 || remaining <= 0)
+    {
+      awaited.erase(s);
+      if (broken)
+        disconnected();
+      read_mutex.unlock();
+
+      if (!sent || fd < 0)
+        throw ErrorDisconnected("connection is closed");
+      throw ErrorNoReply("did not receive a reply before the timeout expired");
+    }
+
+    fill(remaining);
+  }
+}
+
+bool NativeTransport::read_available()
+{
+  read_mutex.lock();
+
+  bool open = fd >= 0;
+
+  // a thread in send_blocking() is reading, and queues what it finds
+  while (open && !readers && received < (size_t)max_received_size)
+  {
+    const size_t before = end;
+
+    open = fill(0);
+    if (end == before)
+      break;
+  }
+
+  throttle();
+  read_mutex.unlock();
+  return open;
+}
+
+bool NativeTransport::pop(std::list<Message> &into)
+{
+  read_mutex.lock();
+
+  const bool any = !incoming.empty();
+
+  if (any)
+  {
+    into.splice(into.end(), incoming, incoming.begin());
+    received -= incoming_sizes.front();
+    incoming_sizes.pop_front();
+    throttle();
+  }
+
+  read_mutex.unlock();
+  return any;
+}
+
+bool NativeTransport::has_incoming()
+{
+  read_mutex.lock();
+  const bool any = !incoming.empty();
+  read_mutex.unlock();
+  return any;
+}
+
+void NativeTransport::outgoing(size_t &bytes, size_t &frames)
+{
+  write_mutex.lock();
+
+  bytes = queued;
+  frames = partial.data ? 1 : 0;
+  for (int l = 0; l < lanes; ++l)
+    frames += queue[l].size();
+
+  write_mutex.unlock();
+}
+
+void NativeTransport::set_max_received_size(long size)
+{
+  read_mutex.lock();
+  max_received_size = size;
+  throttle();
+  read_mutex.unlock();
+}
+
+void NativeTransport::set_max_message_size(long size)
+{
+  read_mutex.lock();
+  max_message_size = size;
+  read_mutex.unlock();
+}
+
+void NativeTransport::set_cork(unsigned int budget_us, size_t bytes)
+{
+  write_mutex.lock();
+  cork_budget = budget_us;
+  cork_bytes = bytes;
+  if (!budget_us)
+    write_queue(SignalLane, true);
+  write_mutex.unlock();
+}
+
+void NativeTransport::set_prioritized(bool on)
+{
+  write_mutex.lock();
+
+  if (prioritized != on && fd >= 0)
+  {
+    // frames already queued keep their order
+    if (!on)
+      write_queue(SignalLane, true);
+
+    /* what the kernel holds is one more queue, which the lanes cannot
+     * reorder; keep it short so that the backlog stays in the lanes
+     */
+    int size;
+    socklen_t length = sizeof(size);
+
+    if (on && !getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, &length))
+    {
+      default_sndbuf = size / 2; // what was asked for, linux reports twice that
+      size = prioritized_sndbuf;
+      setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    }
+    else if (!on && default_sndbuf)
+      setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &default_sndbuf, sizeof(default_sndbuf));
+  }
+  prioritized = on;
+
+  write_mutex.unlock();
+}
+
+void NativeTransport::flush()
+{
+  write_mutex.lock();
+  write_queue(SignalLane, true);
+  write_mutex.unlock();
+}
+
+void NativeTransport::cork_expired()
+{
+  write_mutex.lock();
+  if (queued && monotonic_us() - corked_since >= cork_budget)
+    write_queue(SignalLane, false);
+  write_mutex.unlock();
+}
+
+void NativeTransport::write_ready()
+{
+  write_mutex.lock();
+  write_queue(SignalLane, false);
+  write_mutex.unlock();
+}
+
+void NativeTransport::woken()
+{
+  char discard[64];
+
+  while (read(wakeup[0], discard, sizeof(discard)) > 0)
+    ;
+}
+
+/* gets the dispatcher out of its wait to look at the connection again
+ */
+void NativeTransport::wake()
+{
+  if (wakeup[1] >= 0 && write(wakeup[1], "", 1) < 0)
+    debug_log("native transport: dispatcher wakeup failed");
+}
+
+void NativeTransport::close()
+{
+  read_mutex.lock();
+  disconnected();
+  read_mutex.unlock();
+}
+
+dbus_uint32_t NativeTransport::next_serial()
+{
+  // zero is not a valid serial
+  if (!++serial)
+    ++serial;
+  return serial;
+}
+
+bool NativeTransport::fill(int timeout)
+{
+  if (fd < 0)
+    return false;
+
+  /* read_mutex is dropped while waiting, or the dispatcher would block on
+   * it and never dispatch whatever has to happen for the reply to come;
+   * it leaves the socket to us meanwhile (see read_available()). A reply
+   * read by another waiter does not wake us up, so with several of them
+   * each waits in short slices.
+   */
+  if (timeout)
+  {
+    struct pollfd p = { fd, POLLIN, 0 };
+
+    if (readers && timeout > shared_poll_slice)
+      timeout = shared_poll_slice;
+
+    ++readers;
+    read_mutex.unlock();
+
+    const int ready = poll(&p, 1, timeout);
+
+    read_mutex.lock();
+    --readers;
+
+    if (ready <= 0 || fd < 0)
+      return fd >= 0;
+  }
+
+  if (begin == end)
+    begin = end = 0;
+
+  // room for the rest of a frame known to be large, else for one read
+  const size_t room = wanted > end - begin ? wanted - (end - begin) : read_size;
+
+  if (capacity - end < room)
+  {
+    memmove(buffer, buffer + begin, end - begin);
+    end -= begin;
+    begin = 0;
+
+    if (capacity - end < room)
+    {
+      capacity = end + (room > read_size ? room : read_size);
+      buffer = (char *)dbus_realloc(buffer, capacity);
+    }
+  }
+
+  const ssize_t n = recv(fd, buffer + end, capacity - end, 0);
+
+  if (n > 0)
+  {
+    end += n;
+    frame();
+    return fd >= 0;
+  }
+
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    return true;
+
+  disconnected();
+  return false;
+}
+
+void NativeTransport::frame()
+{
+  wanted = 0;
+
+  while (end - begin >= 16)
+  {
+    const int needed = dbus_message_demarshal_bytes_needed(buffer + begin, end - begin);
+
+    if (needed <= 0 || needed > max_message_size)
+    {
+      debug_log("native transport: corrupt frame, disconnecting");
+      disconnected();
+      return;
+    }
+
+    if ((size_t)needed > end - begin)
+    {
+      wanted = needed;
+      return;
+    }
+
+    const char *data = buffer + begin;
+    InternalError e;
+    DBusMessage *msg = dbus_message_demarshal(data, needed, e);
+
+    if (!msg)
+    {
+      debug_log("native transport: invalid message, disconnecting");
+      disconnected();
+      return;
+    }
+
+    Message::Private *p = new Message::Private(msg);
+
+    // the frame doubles as the buffer wire_reader() decodes in place
+    if (!dbus_message_contains_unix_fds(msg))
+    {
+      char *copy;
+
+      // a large frame read into a buffer of its own is handed over as it is
+      if (begin == 0 && (size_t)needed == end && (size_t)needed > read_size)
+      {
+        copy = buffer;
+        buffer = NULL;
+        capacity = 0;
+      }
+      else if ((copy = (char *)dbus_malloc(needed)))
+        memcpy(copy, data, needed);
+
+      if (copy)
+        p->adopt_wire(copy);
+    }
+
+    begin += needed;
+
+    Message m(p, false);
+    const dbus_uint32_t reply_to = dbus_message_get_reply_serial(msg);
+
+    if (reply_to && awaited.count(reply_to))
+      replies.insert(std::make_pair(reply_to, m));
+    else
+    {
+      incoming.push_back(m);
+      incoming_sizes.push_back(needed);
+      received += needed;
+    }
+  }
+}
+
+/* enables the watch while fewer than max_received_size bytes wait to be
+ * dispatched; called with read_mutex held
+ */
+void NativeTransport::throttle()
+{
+  const bool reading = fd >= 0 && received < (size_t)max_received_size;
+
+  if (watch.enabled != reading)
+  {
+    watch.enabled = reading;
+    if (watch.watch)
+      watch.watch->toggle();
+  }
+}
+
+void NativeTransport::disconnected()
+{
+  if (fd < 0)
+    return;
+
+  // gets the threads waiting in poll() for the socket out before it goes
+  shutdown(fd, SHUT_RDWR);
+
+  write_mutex.lock();
+  ::close(fd);
+  fd = -1;
+  drop_queue();
+  write_mutex.unlock();
+  wake();
+
+  watch.enabled = false;
+  if (watch.watch)
+    watch.watch->toggle();
+  begin = end = wanted = 0;
+
+  // what libdbus synthesizes for its own filters and handlers
+  incoming.push_back(SignalMessage(DBUS_PATH_LOCAL, DBUS_INTERFACE_LOCAL, "Disconnected"));
+  incoming_sizes.push_back(0);
+
+  debug_log("native transport disconnected");
+}
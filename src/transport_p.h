@@ -0,0 +1,293 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef __DBUSXX_TRANSPORT_P_H
+#define __DBUSXX_TRANSPORT_P_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus-c++/connection.h>
+#include <dbus-c++/dispatcher.h>
+#include <dbus-c++/eventloop.h>
+
+#include <dbus/dbus.h>
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace DBus
+{
+
+/* stands in for the DBusWatch libdbus would hand to the dispatcher; Watch
+ * tells the two apart by the low bit of the Internal pointer, which is
+ * never set in libdbus's watches
+ */
+struct DXXAPILOCAL NativeWatch
+{
+  int fd;
+  int flags;  // DBUS_WATCH_READABLE or DBUS_WATCH_WRITABLE
+  bool enabled;
+  Connection::Private *owner;
+  Watch *watch; // the dispatcher's wrapper, 0 while not added
+
+  Watch::Internal *internal()
+  {
+    return reinterpret_cast<Watch::Internal *>(reinterpret_cast<uintptr_t>(this) | 1);
+  }
+
+  static NativeWatch *from(Watch::Internal *i)
+  {
+    const uintptr_t p = reinterpret_cast<uintptr_t>(i);
+
+    return p & 1 ? reinterpret_cast<NativeWatch *>(p & ~uintptr_t(1)) : 0;
+  }
+};
+
+struct NativeTransport;
+
+/* a marshalled message waiting to be written, allocated by libdbus
+ */
+struct DXXAPILOCAL NativeFrame
+{
+  char *data;
+  size_t size;
+  int lane;
+  unsigned int passing; // lanes next() took it ahead of, one bit each
+};
+
+/* the DBusTimeout counterpart of NativeWatch
+ */
+struct DXXAPILOCAL NativeTimeout
+{
+  int interval;
+  bool enabled;
+  Connection::Private *owner;
+  Timeout *timeout; // the dispatcher's wrapper, 0 while not added
+
+  Timeout::Internal *internal()
+  {
+    return reinterpret_cast<Timeout::Internal *>(reinterpret_cast<uintptr_t>(this) | 1);
+  }
+
+  static NativeTimeout *from(Timeout::Internal *i)
+  {
+    const uintptr_t p = reinterpret_cast<uintptr_t>(i);
+
+    return p & 1 ? reinterpret_cast<NativeTimeout *>(p & ~uintptr_t(1)) : 0;
+  }
+};
+
+/* the D-Bus protocol spoken directly over a unix socket: SASL EXTERNAL
+ * authentication, then frames written from the marshalled message and read
+ * in batches into a buffer from which each frame is handed to the message
+ * as its wire buffer (see Message::Private::adopt_wire()).
+ *
+ * Outgoing frames wait in lanes: one FIFO, unless the transport is
+ * prioritized and replies and errors, method calls and signals get a lane
+ * each, written in that order (see next()). send() writes whatever the
+ * socket takes right away and leaves the rest to write_watch, unless the
+ * transport is corked: frames then wait until cork_bytes are queued, an
+ * uncorked write comes, or cork_timeout finds the oldest of them
+ * cork_budget microseconds old. send_blocking(), send_batch() and flush()
+ * wait until the socket took what they need written.
+ *
+ * The dispatcher may be asleep in poll() when another thread needs it to
+ * watch the queue, so that thread wakes it up through wakeup.
+ *
+ * Reads happen from the dispatcher's watch and from send_blocking(), both
+ * under read_mutex, the latter having priority; replies somebody waits for
+ * are set aside so that the dispatcher never sees them. The watch stops
+ * reading while max_received_size bytes wait to be dispatched.
+ */
+struct DXXAPILOCAL NativeTransport
+{
+  int fd;
+  bool broken;  // a write failed and shut the socket down, fd still open
+  std::string guid;
+  std::string unique_name;
+  dbus_uint32_t serial;
+
+  /* bytes read but not yet framed are buffer[begin, end); wanted is the
+   * size of the frame at begin when it is known to be incomplete
+   */
+  char *buffer;
+  size_t begin, end, capacity, wanted;
+
+  int readers; // threads waiting for the socket in send_blocking()
+
+  std::list<Message> incoming;
+  std::deque<size_t> incoming_sizes; // frame size of each of incoming
+  size_t received;                   // their sum
+  long max_received_size;
+  long max_message_size;
+  std::set<dbus_uint32_t> awaited;
+  std::map<dbus_uint32_t, Message> replies;
+
+  DefaultMutex write_mutex;
+  DefaultMutex read_mutex;
+
+  enum Lane
+  {
+    ReplyLane,
+    CallLane,
+    SignalLane,
+    lanes
+  };
+
+  std::deque<NativeFrame> queue[lanes];
+  unsigned int passed[lanes];   // frames written ahead of this lane's first
+  NativeFrame partial;          // frame the socket took part of, or none
+  size_t partial_done;
+  size_t queued;                // bytes in the lanes and partial
+  std::vector<struct iovec> write_iov;   // write_queue()'s, kept for reuse
+  std::vector<NativeFrame> write_batch;
+  bool prioritized;
+  int default_sndbuf;           // SO_SNDBUF to restore when no longer prioritized
+
+  int64_t corked_since;         // when the oldest queued frame was queued
+  unsigned int cork_budget;     // 0 when not corking
+  size_t cork_bytes;
+
+  NativeWatch watch;
+  NativeWatch write_watch;    // enabled while frames wait for room
+  NativeTimeout cork_timeout; // enabled while corked frames wait
+  int wakeup[2];              // pipe read by wakeup_watch
+  NativeWatch wakeup_watch;
+
+  /* connects to the first unix: entry of address that accepts and
+   * authenticates; throws Error otherwise
+   */
+  NativeTransport(const char *address);
+
+  ~NativeTransport();
+
+  static std::string bus_address(DBusBusType);
+
+  bool connected() const
+  {
+    return fd >= 0 && !broken;
+  }
+
+  void close();
+
+  /* assigns a serial unless the message has one and queues it; cork=false
+   * writes what the socket takes and leaves the rest to write_watch;
+   * block=true waits until it, and whatever is queued ahead of it, is written
+   */
+  bool send(DBusMessage *, dbus_uint32_t *serial, bool cork = true, bool block = false);
+
+  /* sends count messages with as few writes as possible, storing each
+   * serial or 0 for those not sent; returns the number sent
+   */
+  size_t send_batch(DBusMessage *const *msgs, size_t count, dbus_uint32_t *serials);
+
+  /* sends and reads until the reply arrives; error replies are thrown
+   */
+  Message send_blocking(DBusMessage *, int timeout);
+
+  /* reads whatever the socket holds without blocking, queueing complete
+   * frames; false once the peer has gone
+   */
+  bool read_available();
+
+  /* moves the next message to dispatch onto the end of into, false if
+   * there is none
+   */
+  bool pop(std::list<Message> &into);
+
+  bool has_incoming();
+
+  /* bytes and frames queued for writing
+   */
+  void outgoing(size_t &bytes, size_t &frames);
+
+  void set_max_received_size(long);
+
+  void set_max_message_size(long);
+
+  void set_cork(unsigned int budget_us, size_t bytes);
+
+  void set_prioritized(bool);
+
+  /* writes out whatever is queued, blocking
+   */
+  void flush();
+
+  /* Timeout::handle() and Watch::handle() for queued frames
+   */
+  void cork_expired();
+
+  void write_ready();
+
+  void woken();
+
+  void wake();
+
+private:
+
+  void authenticate();
+
+  bool write_all(const char *data, size_t length);
+
+  bool write_all(struct iovec *iov, int count);
+
+  bool prepare(DBusMessage *, char **data, int *length);
+
+  Lane lane(DBusMessage *) const;
+
+  void enqueue(const NativeFrame &);
+
+  bool next(NativeFrame &);
+
+  void count_passing(const NativeFrame &);
+
+  bool write_queue(Lane upto, bool block);
+
+  void watch_queue(bool timer, bool writer);
+
+  void drop_queue();
+
+  dbus_uint32_t next_serial();
+
+  bool fill(int timeout);
+
+  void frame();
+
+  void throttle();
+
+  void disconnected();
+};
+
+} /* namespace DBus */
+
+#endif//__DBUSXX_TRANSPORT_P_H
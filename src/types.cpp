@@ -29,6 +29,7 @@
 #include <dbus-c++/object.h>
 #include <dbus/dbus.h>
 #include <cstdlib>
+#include <cstring>
 #include <stdarg.h>
 
 #include "message_p.h"
@@ -36,36 +37,310 @@
 
 namespace DBus {
 
+struct Variant::Slice
+{
+  Message msg;
+  MessageIter iter;
+
+  Slice(const MessageIter &it)
+    : msg(it.msg()), iter(it)
+  {
+    iter._msg = &msg;
+  }
+
+  Slice(const Slice &s)
+    : msg(s.msg), iter(s.iter)
+  {
+    iter._msg = &msg;
+  }
+};
+
 Variant::Variant()
-  : _msg(CallMessage()) // dummy message used as temporary storage for variant data
+  : _type(0), _msg(0), _slice(0)
 {
 }
 
 Variant::Variant(MessageIter &it)
-  : _msg(CallMessage())
+  : _type(0), _msg(0), _slice(0)
 {
   MessageIter vi = it.recurse();
-  MessageIter mi = _msg.writer();
-  vi.copy_data(mi);
+  read_from(vi);
+}
+
+Variant::Variant(const Variant &v)
+  : _type(v._type), _data(v._data), _msg(0),
+    _slice(v._slice ? new Slice(*v._slice) : 0)
+{
+  Message *m = __atomic_load_n(&v._msg, __ATOMIC_ACQUIRE);
+
+  if (m)
+    _msg = new Message(*m);
+}
+
+Variant::Variant(Variant &&v)
+  : _type(v._type), _data(v._data), _msg(v._msg), _slice(v._slice)
+{
+  v._type = 0;
+  v._msg = 0;
+  v._slice = 0;
+}
+
+Variant::~Variant()
+{
+  delete _msg;
+  delete _slice;
 }
 
 Variant &Variant::operator = (const Variant &v)
 {
   if (&v != this)
   {
+    Message *m = __atomic_load_n(&v._msg, __ATOMIC_ACQUIRE);
+
+    m = m ? new Message(*m) : 0;
+    Slice *sl = v._slice ? new Slice(*v._slice) : 0;
+
+    delete _msg;
+    delete _slice;
+    _msg = m;
+    _slice = sl;
+    _type = v._type;
+    _data = v._data;
+  }
+  return *this;
+}
+
+Variant &Variant::operator = (Variant &&v)
+{
+  if (&v != this)
+  {
+    delete _msg;
+    delete _slice;
     _msg = v._msg;
+    _slice = v._slice;
+    _type = v._type;
+    _data = v._data;
+    v._msg = 0;
+    v._slice = 0;
+    v._type = 0;
   }
   return *this;
 }
 
 void Variant::clear()
 {
-  CallMessage empty;
-  _msg = empty;
+  delete _msg;
+  delete _slice;
+  _msg = 0;
+  _slice = 0;
+  _type = 0;
+}
+
+void Variant::detach()
+{
+  if (!_slice)
+    return;
+
+  Slice *slice = _slice;
+  _slice = 0;
+
+  MessageIter from = slice->iter;
+  MessageIter to = msg().writer();
+  from.copy_data(to);
+
+  delete slice;
+}
+
+MessageIter Variant::reader() const
+{
+  if (_slice)
+    return _slice->iter;
+
+  return msg().reader();
+}
+
+Message &Variant::msg() const
+{
+  Message *m = __atomic_load_n(&_msg, __ATOMIC_ACQUIRE);
+
+  if (m)
+    return *m;
+
+  // const readers may get here together, the first one to publish wins
+  m = new Message(CallMessage());
+
+  if (_type)
+  {
+    MessageIter wi = m->writer();
+    append_inline(wi);
+  }
+
+  Message *none = 0;
+
+  if (!__atomic_compare_exchange_n(&_msg, &none, m, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+  {
+    delete m;
+    m = none;
+  }
+  return *m;
+}
+
+MessageIter Variant::writer()
+{
+  detach();
+
+  Message &m = msg();
+
+  // from now on the message is the only valid storage
+  _type = 0;
+
+  return m.writer();
+}
+
+bool Variant::set_inline_string(char type, const char *chars)
+{
+  size_t len = strlen(chars);
+
+  if (len >= inline_size)
+    return false;
+
+  memcpy(_data.s, chars, len + 1);
+  _type = type;
+  return true;
+}
+
+void Variant::assign(const std::string &value)
+{
+  if (!set_inline_string('s', value.c_str()))
+  {
+    MessageIter wi = writer();
+    wi.append_string(value.c_str());
+  }
+}
+
+void Variant::assign(const Path &value)
+{
+  if (!set_inline_string('o', value.c_str()))
+  {
+    MessageIter wi = writer();
+    wi.append_path(value.c_str());
+  }
+}
+
+void Variant::assign(const Signature &value)
+{
+  if (!set_inline_string('g', value.c_str()))
+  {
+    MessageIter wi = writer();
+    wi.append_signature(value.c_str());
+  }
+}
+
+void Variant::append_inline(MessageIter &it) const
+{
+  switch (_type)
+  {
+  case 'y':
+    it.append_byte(_data.y);
+    break;
+  case 'b':
+    it.append_bool(_data.b);
+    break;
+  case 'n':
+    it.append_int16(_data.n);
+    break;
+  case 'q':
+    it.append_uint16(_data.q);
+    break;
+  case 'i':
+    it.append_int32(_data.i);
+    break;
+  case 'u':
+    it.append_uint32(_data.u);
+    break;
+  case 'x':
+    it.append_int64(_data.x);
+    break;
+  case 't':
+    it.append_uint64(_data.t);
+    break;
+  case 'd':
+    it.append_double(_data.d);
+    break;
+  case 's':
+    it.append_string(_data.s);
+    break;
+  case 'o':
+    it.append_path(_data.s);
+    break;
+  case 'g':
+    it.append_signature(_data.s);
+    break;
+  }
+}
+
+void Variant::read_from(MessageIter &vi)
+{
+  switch (vi.type())
+  {
+  case DBUS_TYPE_BYTE:
+    assign(vi.get_byte());
+    return;
+  case DBUS_TYPE_BOOLEAN:
+    assign(vi.get_bool());
+    return;
+  case DBUS_TYPE_INT16:
+    assign(static_cast<int16_t>(vi.get_int16()));
+    return;
+  case DBUS_TYPE_UINT16:
+    assign(static_cast<uint16_t>(vi.get_uint16()));
+    return;
+  case DBUS_TYPE_INT32:
+    assign(static_cast<int32_t>(vi.get_int32()));
+    return;
+  case DBUS_TYPE_UINT32:
+    assign(static_cast<uint32_t>(vi.get_uint32()));
+    return;
+  case DBUS_TYPE_INT64:
+    assign(static_cast<int64_t>(vi.get_int64()));
+    return;
+  case DBUS_TYPE_UINT64:
+    assign(static_cast<uint64_t>(vi.get_uint64()));
+    return;
+  case DBUS_TYPE_DOUBLE:
+    assign(vi.get_double());
+    return;
+  case DBUS_TYPE_STRING:
+    if (set_inline_string('s', vi.get_string()))
+      return;
+    break;
+  case DBUS_TYPE_OBJECT_PATH:
+    if (set_inline_string('o', vi.get_path()))
+      return;
+    break;
+  case DBUS_TYPE_SIGNATURE:
+    if (set_inline_string('g', vi.get_signature()))
+      return;
+    break;
+  }
+
+  // messages with a serial have been received or sent and can't change
+  // anymore; their wire_reader() buffer can still be dropped by writer()
+  if (vi.msg().serial() != 0 && !vi._wire)
+  {
+    _slice = new Slice(vi);
+    return;
+  }
+
+  MessageIter mi = writer();
+  vi.copy_data(mi);
 }
 
 const Signature Variant::signature() const
 {
+  if (_type)
+    return Signature(std::string(1, _type));
+
   char *sigbuf = reader().signature();
 
   Signature signature = sigbuf;
@@ -77,6 +352,17 @@ const Signature Variant::signature() const
 
 MessageIter &operator << (MessageIter &iter, const Variant &val)
 {
+  if (val._type)
+  {
+    const char sig[] = { val._type, '\0' };
+
+    MessageIter wit = iter.new_variant(sig);
+    val.append_inline(wit);
+    iter.close_container(wit);
+
+    return iter;
+  }
+
   const Signature sig = val.signature();
 
   MessageIter rit = val.reader();
@@ -97,9 +383,8 @@ MessageIter &operator >> (MessageIter &iter, Variant &val)
   val.clear();
 
   MessageIter vit = iter.recurse();
-  MessageIter mit = val.writer();
 
-  vit.copy_data(mit);
+  val.read_from(vit);
 
   return ++iter;
 }
@@ -0,0 +1,292 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus/dbus.h>
+
+#include "wire_p.h"
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#define DBUSXX_SIMD_VALIDATE 1
+#include <immintrin.h>
+#endif
+
+using namespace DBus;
+
+typedef size_t (*SkipFunction)(const unsigned char *, size_t, size_t);
+
+/* index of the first byte at or after i that is not plain ASCII, or is nul
+ */
+static size_t skip_ascii_scalar(const unsigned char *s, size_t i, size_t n)
+{
+  while (i < n && s[i] && s[i] < 0x80)
+    ++i;
+  return i;
+}
+
+#ifdef DBUSXX_SIMD_VALIDATE
+
+static size_t skip_ascii_sse2(const unsigned char *s, size_t i, size_t n)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  for (; i + 16 <= n; i += 16)
+  {
+    const __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+    // the sign bit marks non-ASCII bytes
+    if (_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero))))
+      break;
+  }
+  return skip_ascii_scalar(s, i, n);
+}
+
+__attribute__((target("avx2")))
+static size_t skip_ascii_avx2(const unsigned char *s, size_t i, size_t n)
+{
+  const __m256i zero = _mm256_setzero_si256();
+
+  for (; i + 32 <= n; i += 32)
+  {
+    const __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+
+    if (_mm256_movemask_epi8(_mm256_or_si256(v, _mm256_cmpeq_epi8(v, zero))))
+      break;
+  }
+  // GCC omits vzeroupper on tail calls, and legacy SSE code in the
+  // callers would then pay for the dirty upper halves
+  _mm256_zeroupper();
+  return skip_ascii_sse2(s, i, n);
+}
+
+#endif//DBUSXX_SIMD_VALIDATE
+
+static SkipFunction select_skip_ascii()
+{
+#ifdef DBUSXX_SIMD_VALIDATE
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    return skip_ascii_avx2;
+  return skip_ascii_sse2;
+#else
+  return skip_ascii_scalar;
+#endif
+}
+
+bool DBus::wire_valid_utf8(const char *chars, size_t length)
+{
+  static const SkipFunction skip_ascii = select_skip_ascii();
+
+  const unsigned char *s = (const unsigned char *)chars;
+  size_t i = 0;
+
+  while ((i = skip_ascii(s, i, length)) < length)
+  {
+    const unsigned char c = s[i];
+    size_t extra;
+    uint32_t code, min;
+
+    if (c < 0x80)
+      return false; // nul
+    else if ((c & 0xe0) == 0xc0)
+      extra = 1, code = c & 0x1f, min = 0x80;
+    else if ((c & 0xf0) == 0xe0)
+      extra = 2, code = c & 0x0f, min = 0x800;
+    else if ((c & 0xf8) == 0xf0)
+      extra = 3, code = c & 0x07, min = 0x10000;
+    else
+      return false;
+
+    if (length - i <= extra)
+      return false;
+
+    for (size_t k = 1; k <= extra; ++k)
+    {
+      if ((s[i + k] & 0xc0) != 0x80)
+        return false;
+      code = (code << 6) | (s[i + k] & 0x3f);
+    }
+
+    // overlong forms, surrogates and values past the last code point
+    if (code < min || code > 0x10ffff || (code & 0xfffff800) == 0xd800)
+      return false;
+
+    i += extra + 1;
+  }
+  return true;
+}
+
+static bool path_char(unsigned char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '/';
+}
+
+bool DBus::wire_valid_path(const char *chars, size_t length)
+{
+  const unsigned char *s = (const unsigned char *)chars;
+
+  if (length == 0 || s[0] != '/')
+    return false;
+  if (length == 1)
+    return true;
+  if (s[length - 1] == '/')
+    return false;
+
+  size_t i = 0;
+
+#ifdef DBUSXX_SIMD_VALIDATE
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i underscore = _mm_set1_epi8('_');
+  bool carry = false; // the previous block ended with a slash
+
+  for (; i + 16 <= length; i += 16)
+  {
+    const __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+    // folding case maps both letter ranges onto 'A'..'Z'; bytes >= 0x80
+    // are negative and fall below every range
+    const __m128i upper = _mm_and_si128(v, _mm_set1_epi8((char)0xdf));
+    const __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(upper, _mm_set1_epi8('A' - 1)),
+                                        _mm_cmplt_epi8(upper, _mm_set1_epi8('Z' + 1)));
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                        _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    const __m128i slashes = _mm_cmpeq_epi8(v, slash);
+    const __m128i ok = _mm_or_si128(_mm_or_si128(alpha, digit),
+                                    _mm_or_si128(slashes, _mm_cmpeq_epi8(v, underscore)));
+
+    if (_mm_movemask_epi8(ok) != 0xffff)
+      return false;
+
+    // empty segments show up as two adjacent slashes
+    const unsigned m = _mm_movemask_epi8(slashes);
+
+    if ((m & (m >> 1)) || (carry && (m & 1)))
+      return false;
+
+    carry = m & 0x8000;
+  }
+#endif
+
+  for (; i < length; ++i)
+  {
+    if (!path_char(s[i]) || (s[i] == '/' && i && s[i - 1] == '/'))
+      return false;
+  }
+  return true;
+}
+
+static bool basic_type(char c)
+{
+  switch (c)
+  {
+  case DBUS_TYPE_BYTE:
+  case DBUS_TYPE_BOOLEAN:
+  case DBUS_TYPE_INT16:
+  case DBUS_TYPE_UINT16:
+  case DBUS_TYPE_INT32:
+  case DBUS_TYPE_UINT32:
+  case DBUS_TYPE_INT64:
+  case DBUS_TYPE_UINT64:
+  case DBUS_TYPE_DOUBLE:
+  case DBUS_TYPE_STRING:
+  case DBUS_TYPE_OBJECT_PATH:
+  case DBUS_TYPE_SIGNATURE:
+  case DBUS_TYPE_UNIX_FD:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/* position past the single complete type at s, or 0 if it is not one
+ */
+static const char *complete_type(const char *s, const char *end, int arrays, int structs, int dicts)
+{
+  if (s == end)
+    return 0;
+
+  if (basic_type(*s) || *s == DBUS_TYPE_VARIANT)
+    return s + 1;
+
+  switch (*s)
+  {
+  case DBUS_TYPE_ARRAY:
+    if (++arrays > DBUS_MAXIMUM_TYPE_RECURSION_DEPTH)
+      return 0;
+
+    if (s + 1 < end && s[1] == DBUS_DICT_ENTRY_BEGIN_CHAR)
+    {
+      if (++dicts > DBUS_MAXIMUM_TYPE_RECURSION_DEPTH)
+        return 0;
+
+      s += 2;
+      if (s == end || !basic_type(*s))
+        return 0;
+
+      s = complete_type(s + 1, end, arrays, structs, dicts);
+      if (!s || s == end || *s != DBUS_DICT_ENTRY_END_CHAR)
+        return 0;
+
+      return s + 1;
+    }
+    return complete_type(s + 1, end, arrays, structs, dicts);
+
+  case DBUS_STRUCT_BEGIN_CHAR:
+    if (++structs > DBUS_MAXIMUM_TYPE_RECURSION_DEPTH)
+      return 0;
+
+    ++s;
+    if (s != end && *s == DBUS_STRUCT_END_CHAR)
+      return 0; // empty struct
+
+    while (s && s != end && *s != DBUS_STRUCT_END_CHAR)
+      s = complete_type(s, end, arrays, structs, dicts);
+
+    return s && s != end ? s + 1 : 0;
+
+  default:
+    return 0;
+  }
+}
+
+bool DBus::wire_valid_signature(const char *chars, size_t length)
+{
+  // signatures are at most 255 bytes, a plain recursive descent will do
+  if (length > DBUS_MAXIMUM_SIGNATURE_LENGTH)
+    return false;
+
+  const char *end = chars + length;
+
+  for (const char *s = chars; s != end; )
+  {
+    s = complete_type(s, end, 0, 0, 0);
+
+    if (!s)
+      return false;
+  }
+  return true;
+}
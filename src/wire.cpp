@@ -0,0 +1,735 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus-c++/wire.h>
+#include <dbus/dbus.h>
+#include <cstdlib>
+#include <cstring>
+
+#include "message_p.h"
+#include "wire_p.h"
+#include "internalerror.h"
+
+using namespace DBus;
+
+size_t DBus::wire_alignment(char t)
+{
+  switch (t)
+  {
+  case DBUS_TYPE_BYTE:
+  case DBUS_TYPE_SIGNATURE:
+  case DBUS_TYPE_VARIANT:
+    return 1;
+  case DBUS_TYPE_INT16:
+  case DBUS_TYPE_UINT16:
+    return 2;
+  case DBUS_TYPE_INT64:
+  case DBUS_TYPE_UINT64:
+  case DBUS_TYPE_DOUBLE:
+  case DBUS_STRUCT_BEGIN_CHAR:
+  case DBUS_DICT_ENTRY_BEGIN_CHAR:
+    return 8;
+  default:
+    return 4;
+  }
+}
+
+size_t DBus::wire_fixed_size(char t)
+{
+  switch (t)
+  {
+  case DBUS_TYPE_BYTE:
+    return 1;
+  case DBUS_TYPE_INT16:
+  case DBUS_TYPE_UINT16:
+    return 2;
+  case DBUS_TYPE_BOOLEAN:
+  case DBUS_TYPE_INT32:
+  case DBUS_TYPE_UINT32:
+    return 4;
+  case DBUS_TYPE_INT64:
+  case DBUS_TYPE_UINT64:
+  case DBUS_TYPE_DOUBLE:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+char DBus::host_byte_order()
+{
+  const uint16_t probe = 1;
+
+  return *(const char *)&probe ? DBUS_LITTLE_ENDIAN : DBUS_BIG_ENDIAN;
+}
+
+const char *DBus::wire_skip_signature(const char *sig)
+{
+  int depth = 0;
+
+  while (*sig)
+  {
+    switch (*sig++)
+    {
+    case DBUS_TYPE_ARRAY:
+      continue;
+    case DBUS_STRUCT_BEGIN_CHAR:
+    case DBUS_DICT_ENTRY_BEGIN_CHAR:
+      ++depth;
+      continue;
+    case DBUS_STRUCT_END_CHAR:
+    case DBUS_DICT_ENTRY_END_CHAR:
+      --depth;
+      break;
+    }
+
+    if (depth == 0)
+      break;
+  }
+  return sig;
+}
+
+static uint32_t load_uint32(const unsigned char *p)
+{
+  uint32_t u;
+  memcpy(&u, p, sizeof(u));
+  return u;
+}
+
+size_t DBus::wire_skip_value(const unsigned char *body, size_t pos, const char *sig)
+{
+  switch (*sig)
+  {
+  case DBUS_TYPE_STRING:
+  case DBUS_TYPE_OBJECT_PATH:
+    pos = wire_align(pos, 4);
+    return pos + 4 + load_uint32(body + pos) + 1;
+
+  case DBUS_TYPE_SIGNATURE:
+    return pos + 1 + body[pos] + 1;
+
+  case DBUS_TYPE_ARRAY:
+  {
+    pos = wire_align(pos, 4);
+    const uint32_t length = load_uint32(body + pos);
+    return wire_align(pos + 4, wire_alignment(sig[1])) + length;
+  }
+  case DBUS_TYPE_VARIANT:
+  {
+    const char *contained = (const char *)body + pos + 1;
+    return wire_skip_value(body, pos + 1 + body[pos] + 1, contained);
+  }
+  case DBUS_STRUCT_BEGIN_CHAR:
+  case DBUS_DICT_ENTRY_BEGIN_CHAR:
+    pos = wire_align(pos, 8);
+    for (++sig; *sig != DBUS_STRUCT_END_CHAR && *sig != DBUS_DICT_ENTRY_END_CHAR; sig = wire_skip_signature(sig))
+      pos = wire_skip_value(body, pos, sig);
+    return pos;
+
+  default:
+  {
+    const size_t size = wire_fixed_size(*sig);
+    return wire_align(pos, size) + size;
+  }
+  }
+}
+
+static void swap_one(unsigned char *p, size_t size)
+{
+  for (size_t i = 0; i < size / 2; ++i)
+  {
+    const unsigned char c = p[i];
+    p[i] = p[size - 1 - i];
+    p[size - 1 - i] = c;
+  }
+}
+
+/* swaps the value at pos in place and returns the offset just past it;
+ * lengths are read after swapping so the walk follows host order
+ */
+static size_t swap_value(unsigned char *body, size_t pos, const char *sig)
+{
+  switch (*sig)
+  {
+  case DBUS_TYPE_STRING:
+  case DBUS_TYPE_OBJECT_PATH:
+    pos = wire_align(pos, 4);
+    swap_one(body + pos, 4);
+    return pos + 4 + load_uint32(body + pos) + 1;
+
+  case DBUS_TYPE_SIGNATURE:
+    return pos + 1 + body[pos] + 1;
+
+  case DBUS_TYPE_ARRAY:
+  {
+    pos = wire_align(pos, 4);
+    swap_one(body + pos, 4);
+
+    const uint32_t length = load_uint32(body + pos);
+    const size_t size = wire_fixed_size(sig[1]);
+
+    pos = wire_align(pos + 4, wire_alignment(sig[1]));
+
+    const size_t end = pos + length;
+
+    if (size)
+    {
+      // the whole array in one go, rather than element by element
+      wire_swap_array(body + pos, size, length / size);
+    }
+    else
+    {
+      while (pos < end)
+        pos = swap_value(body, pos, sig + 1);
+    }
+    return end;
+  }
+  case DBUS_TYPE_VARIANT:
+  {
+    const char *contained = (const char *)body + pos + 1;
+    return swap_value(body, pos + 1 + body[pos] + 1, contained);
+  }
+  case DBUS_STRUCT_BEGIN_CHAR:
+  case DBUS_DICT_ENTRY_BEGIN_CHAR:
+    pos = wire_align(pos, 8);
+    for (++sig; *sig != DBUS_STRUCT_END_CHAR && *sig != DBUS_DICT_ENTRY_END_CHAR; sig = wire_skip_signature(sig))
+      pos = swap_value(body, pos, sig);
+    return pos;
+
+  default:
+  {
+    const size_t size = wire_fixed_size(*sig);
+    pos = wire_align(pos, size);
+    swap_one(body + pos, size);
+    return pos + size;
+  }
+  }
+}
+
+void DBus::wire_swap_array(void *data, size_t size, size_t count)
+{
+  unsigned char *p = (unsigned char *)data;
+
+  switch (size)
+  {
+  case 2:
+    for (; count; --count, p += 2)
+    {
+      uint16_t v;
+      memcpy(&v, p, 2);
+      v = (v >> 8) | (v << 8);
+      memcpy(p, &v, 2);
+    }
+    break;
+  case 4:
+    for (; count; --count, p += 4)
+    {
+      uint32_t v;
+      memcpy(&v, p, 4);
+      v = __builtin_bswap32(v);
+      memcpy(p, &v, 4);
+    }
+    break;
+  case 8:
+    for (; count; --count, p += 8)
+    {
+      uint64_t v;
+      memcpy(&v, p, 8);
+      v = __builtin_bswap64(v);
+      memcpy(p, &v, 8);
+    }
+    break;
+  }
+}
+
+void DBus::wire_swap_body(unsigned char *body, size_t size, const char *signature)
+{
+  size_t pos = 0;
+
+  for (const char *sig = signature; *sig && pos < size; sig = wire_skip_signature(sig))
+    pos = swap_value(body, pos, sig);
+}
+
+/* room kept in front of the body for the header of message(), a multiple of
+ * 8 so that the body stays 8-aligned relative to the message start
+ */
+static const size_t header_room = 256;
+
+WireWriter::WireWriter(size_t capacity)
+  : _data(0), _size(0), _capacity(0), _depth(0), _checked(true)
+{
+  if (capacity) grow(capacity);
+}
+
+WireWriter::~WireWriter()
+{
+  if (_data) free(_data - header_room);
+}
+
+void WireWriter::grow(size_t n)
+{
+  size_t capacity = _capacity ? _capacity : 256;
+
+  while (capacity < _size + n)
+    capacity *= 2;
+
+  unsigned char *data = (unsigned char *)realloc(_data ? _data - header_room : 0, header_room + capacity);
+
+  if (!data) throw ErrorNoMemory("unable to grow message buffer");
+
+  _data = data + header_room;
+  _capacity = capacity;
+}
+
+void WireWriter::check(char type, const char *chars, size_t length) const
+{
+  switch (type)
+  {
+  case DBUS_TYPE_STRING:
+    if (!wire_valid_utf8(chars, length))
+      throw ErrorInvalidArgs("invalid UTF-8 string");
+    break;
+  case DBUS_TYPE_OBJECT_PATH:
+    if (!wire_valid_path(chars, length))
+      throw ErrorInvalidArgs("invalid object path");
+    break;
+  case DBUS_TYPE_SIGNATURE:
+    if (!wire_valid_signature(chars, length))
+      throw ErrorInvalidArgs("invalid signature");
+    break;
+  }
+}
+
+void WireWriter::clear()
+{
+  _size = 0;
+  _depth = 0;
+  _signature.clear();
+  _arrays.clear();
+}
+
+void WireWriter::append_array(char type, const void *ptr, size_t length)
+{
+  const size_t size = wire_fixed_size(type);
+
+  if (!size)
+    throw ErrorInvalidArgs("fixed-size element type expected");
+
+  if (_depth == 0)
+  {
+    _signature += DBUS_TYPE_ARRAY;
+    _signature += type;
+  }
+
+  align(4);
+  put<uint32_t>(length * size);
+  align(size);
+  put_bytes(ptr, length * size);
+}
+
+void WireWriter::open_array(const char *sig)
+{
+  if (_depth == 0)
+  {
+    _signature += DBUS_TYPE_ARRAY;
+    _signature += sig;
+  }
+
+  align(4);
+  _arrays.push_back(_size);
+  put<uint32_t>(0);
+
+  // the length does not include the padding up to the first element
+  align(wire_alignment(sig[0]));
+  uint32_t start = _size;
+  memcpy(_data + _arrays.back(), &start, sizeof(start));
+
+  ++_depth;
+}
+
+void WireWriter::close_array()
+{
+  const size_t at = _arrays.back();
+  uint32_t start;
+
+  memcpy(&start, _data + at, sizeof(start));
+
+  const uint32_t length = _size - start;
+  memcpy(_data + at, &length, sizeof(length));
+
+  _arrays.pop_back();
+  --_depth;
+}
+
+void WireWriter::open_struct(const char *sig)
+{
+  top(sig);
+  align(8);
+  ++_depth;
+}
+
+void WireWriter::close_struct()
+{
+  --_depth;
+}
+
+void WireWriter::open_dict_entry()
+{
+  align(8);
+  ++_depth;
+}
+
+void WireWriter::close_dict_entry()
+{
+  --_depth;
+}
+
+void WireWriter::open_variant(const char *sig)
+{
+  top("v");
+  put_signature(sig, strlen(sig));
+  ++_depth;
+}
+
+void WireWriter::close_variant()
+{
+  --_depth;
+}
+
+void WireWriter::append_iter(MessageIter &it)
+{
+  if (append_subtree(it))
+    return;
+
+  switch (it.type())
+  {
+  case DBUS_TYPE_BYTE:
+    append_byte(it.get_byte());
+    break;
+  case DBUS_TYPE_BOOLEAN:
+    append_bool(it.get_bool());
+    break;
+  case DBUS_TYPE_INT16:
+    append_int16(it.get_int16());
+    break;
+  case DBUS_TYPE_UINT16:
+    append_uint16(it.get_uint16());
+    break;
+  case DBUS_TYPE_INT32:
+    append_int32(it.get_int32());
+    break;
+  case DBUS_TYPE_UINT32:
+    append_uint32(it.get_uint32());
+    break;
+  case DBUS_TYPE_INT64:
+    append_int64(it.get_int64());
+    break;
+  case DBUS_TYPE_UINT64:
+    append_uint64(it.get_uint64());
+    break;
+  case DBUS_TYPE_DOUBLE:
+    append_double(it.get_double());
+    break;
+  case DBUS_TYPE_STRING:
+  {
+    const char *chars = it.get_string();
+    append_string(chars, strlen(chars));
+    break;
+  }
+  case DBUS_TYPE_OBJECT_PATH:
+  {
+    const char *chars = it.get_path();
+    append_path(chars, strlen(chars));
+    break;
+  }
+  case DBUS_TYPE_SIGNATURE:
+  {
+    const char *chars = it.get_signature();
+    append_signature(chars, strlen(chars));
+    break;
+  }
+  case DBUS_TYPE_ARRAY:
+  {
+    char *sig = it.signature();
+    MessageIter ait = it.recurse();
+
+    if (wire_fixed_size(sig[1]))
+    {
+      void *ptr;
+      int length = ait.get_array(&ptr);
+      append_array(sig[1], ptr, length);
+    }
+    else
+    {
+      open_array(sig + 1);
+      for (; !ait.at_end(); ++ait)
+        append_iter(ait);
+      close_array();
+    }
+    free(sig);
+    break;
+  }
+  case DBUS_TYPE_STRUCT:
+  {
+    char *sig = it.signature();
+    open_struct(sig);
+    free(sig);
+
+    for (MessageIter sit = it.recurse(); !sit.at_end(); ++sit)
+      append_iter(sit);
+    close_struct();
+    break;
+  }
+  case DBUS_TYPE_DICT_ENTRY:
+  {
+    open_dict_entry();
+    for (MessageIter eit = it.recurse(); !eit.at_end(); ++eit)
+      append_iter(eit);
+    close_dict_entry();
+    break;
+  }
+  case DBUS_TYPE_VARIANT:
+  {
+    MessageIter vit = it.recurse();
+    char *sig = vit.signature();
+    open_variant(sig);
+    free(sig);
+
+    append_iter(vit);
+    close_variant();
+    break;
+  }
+  default:
+    throw ErrorInvalidArgs("type can't be serialized");
+  }
+}
+
+bool WireWriter::append_subtree(MessageIter &it)
+{
+  if (!it._wire)
+    return false;
+
+  switch (it.type())
+  {
+  case DBUS_TYPE_ARRAY:
+  case DBUS_TYPE_STRUCT:
+  case DBUS_TYPE_VARIANT:
+  case DBUS_TYPE_DICT_ENTRY:
+    break;
+  default:
+    return false;
+  }
+
+  const size_t alignment = wire_alignment(*it._wsig);
+  const size_t from = wire_align(it._wpos, alignment);
+
+  // the padding inside the value is only the same at the same offset mod 8
+  if (from % 8 != wire_align(_size, alignment) % 8)
+    return false;
+
+  const size_t to = wire_skip_value(it._wire, from, it._wsig);
+
+  if (_depth == 0)
+    _signature.append(it._wsig, wire_skip_signature(it._wsig) - it._wsig);
+
+  align(alignment);
+  put_bytes(it._wire + from, to - from);
+  return true;
+}
+
+void WireWriter::append_variant(const Variant &v)
+{
+  if (v._type)
+  {
+    const char sig[] = { v._type, '\0' };
+
+    open_variant(sig);
+    switch (v._type)
+    {
+    case DBUS_TYPE_BYTE:
+      append_byte(v._data.y);
+      break;
+    case DBUS_TYPE_BOOLEAN:
+      append_bool(v._data.b);
+      break;
+    case DBUS_TYPE_INT16:
+      append_int16(v._data.n);
+      break;
+    case DBUS_TYPE_UINT16:
+      append_uint16(v._data.q);
+      break;
+    case DBUS_TYPE_INT32:
+      append_int32(v._data.i);
+      break;
+    case DBUS_TYPE_UINT32:
+      append_uint32(v._data.u);
+      break;
+    case DBUS_TYPE_INT64:
+      append_int64(v._data.x);
+      break;
+    case DBUS_TYPE_UINT64:
+      append_uint64(v._data.t);
+      break;
+    case DBUS_TYPE_DOUBLE:
+      append_double(v._data.d);
+      break;
+    case DBUS_TYPE_STRING:
+      append_string(v._data.s, strlen(v._data.s));
+      break;
+    case DBUS_TYPE_OBJECT_PATH:
+      append_path(v._data.s, strlen(v._data.s));
+      break;
+    case DBUS_TYPE_SIGNATURE:
+      append_signature(v._data.s, strlen(v._data.s));
+      break;
+    }
+    close_variant();
+    return;
+  }
+
+  MessageIter it = v.reader();
+
+  if (it.at_end())
+    throw ErrorInvalidArgs("empty variant");
+
+  char *sig = it.signature();
+  open_variant(sig);
+  free(sig);
+
+  append_iter(it);
+  close_variant();
+}
+
+void WireWriter::put_header(const Message &head, uint32_t serial, WireWriter &out) const
+{
+  DBusMessage *msg = head._pvt->msg;
+  uint8_t flags = 0;
+
+  if (dbus_message_get_no_reply(msg))
+    flags |= DBUS_HEADER_FLAG_NO_REPLY_EXPECTED;
+  if (!dbus_message_get_auto_start(msg))
+    flags |= DBUS_HEADER_FLAG_NO_AUTO_START;
+#if DBUS_VERSION >= 0x01080a // dbus_message_get_allow_interactive_authorization() is new in 1.8.10
+  if (dbus_message_get_allow_interactive_authorization(msg))
+    flags |= DBUS_HEADER_FLAG_ALLOW_INTERACTIVE_AUTHORIZATION;
+#endif
+
+  out.put<uint8_t>(host_byte_order());
+  out.put<uint8_t>(dbus_message_get_type(msg));
+  out.put<uint8_t>(flags);
+  out.put<uint8_t>(DBUS_MAJOR_PROTOCOL_VERSION);
+  out.put<uint32_t>(_size);
+  out.put<uint32_t>(serial);
+
+  struct
+  {
+    uint8_t code;
+    char type;
+    const char *value;
+  } fields[] = {
+    { DBUS_HEADER_FIELD_PATH, DBUS_TYPE_OBJECT_PATH, dbus_message_get_path(msg) },
+    { DBUS_HEADER_FIELD_INTERFACE, DBUS_TYPE_STRING, dbus_message_get_interface(msg) },
+    { DBUS_HEADER_FIELD_MEMBER, DBUS_TYPE_STRING, dbus_message_get_member(msg) },
+    { DBUS_HEADER_FIELD_ERROR_NAME, DBUS_TYPE_STRING, dbus_message_get_error_name(msg) },
+    { DBUS_HEADER_FIELD_DESTINATION, DBUS_TYPE_STRING, dbus_message_get_destination(msg) },
+    { DBUS_HEADER_FIELD_SENDER, DBUS_TYPE_STRING, dbus_message_get_sender(msg) },
+    { DBUS_HEADER_FIELD_SIGNATURE, DBUS_TYPE_SIGNATURE, _signature.empty() ? 0 : _signature.c_str() },
+  };
+
+  out.open_array("(yv)");
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i)
+  {
+    if (!fields[i].value) continue;
+
+    const char sig[] = { fields[i].type, '\0' };
+    const size_t length = strlen(fields[i].value);
+
+    out.open_struct("(yv)");
+    out.append_byte(fields[i].code);
+    out.open_variant(sig);
+    if (fields[i].type == DBUS_TYPE_SIGNATURE)
+      out.put_signature(fields[i].value, length);
+    else
+      out.put_string(fields[i].value, length);
+    out.close_variant();
+    out.close_struct();
+  }
+
+  const uint32_t reply_serial = dbus_message_get_reply_serial(msg);
+  if (reply_serial)
+  {
+    out.open_struct("(yv)");
+    out.append_byte(DBUS_HEADER_FIELD_REPLY_SERIAL);
+    out.open_variant("u");
+    out.append_uint32(reply_serial);
+    out.close_variant();
+    out.close_struct();
+  }
+  out.close_array();
+
+  // the body starts 8-aligned, which the body offsets already assume
+  out.align(8);
+}
+
+Message WireWriter::message(const Message &head)
+{
+  WireWriter out(header_room);
+
+  // libdbus refuses to load serial 0, the copy below clears it again
+  put_header(head, 1, out);
+
+  if (!_data) grow(0);
+
+  const char *start;
+  size_t length;
+
+  if (out._size <= header_room)
+  {
+    // the header lands right in front of the body, so the body is not moved
+    memcpy(_data - out._size, out._data, out._size);
+    start = (const char *)_data - out._size;
+    length = out._size + _size;
+  }
+  else
+  {
+    out.put_bytes(_data, _size);
+    start = (const char *)out._data;
+    length = out._size;
+  }
+
+  InternalError e;
+  DBusMessage *loaded = dbus_message_demarshal(start, length, e);
+
+  if (e) throw Error(e);
+
+  DBusMessage *msg = dbus_message_copy(loaded);
+  dbus_message_unref(loaded);
+
+  if (!msg) throw ErrorNoMemory("unable to copy message");
+
+  return Message(new Message::Private(msg), false);
+}
@@ -0,0 +1,83 @@
+/*
+ *
+ *  D-Bus++ - C++ bindings for D-Bus
+ *
+ *  Copyright (C) 2005-2007  Paolo Durante <shackan@gmail.com>
+ *
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef __DBUSXX_WIRE_P_H
+#define __DBUSXX_WIRE_P_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus-c++/api.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace DBus
+{
+
+/* alignment of the values whose signature starts with t
+ */
+DXXAPILOCAL size_t wire_alignment(char t);
+
+/* size of a fixed-size basic value, 0 otherwise
+ */
+DXXAPILOCAL size_t wire_fixed_size(char t);
+
+DXXAPILOCAL char host_byte_order();
+
+inline size_t wire_align(size_t pos, size_t n)
+{
+  return (pos + n - 1) & ~(n - 1);
+}
+
+/* position just past the single complete type starting at sig
+ */
+DXXAPILOCAL const char *wire_skip_signature(const char *sig);
+
+/* offset just past the value of type sig stored at pos in a host-order body
+ */
+DXXAPILOCAL size_t wire_skip_value(const unsigned char *body, size_t pos, const char *sig);
+
+/* reverses the bytes of count elements of the given size in place
+ */
+DXXAPILOCAL void wire_swap_array(void *data, size_t size, size_t count);
+
+/* converts a body marshalled in the opposite byte order to host order,
+ * in place; body must have been validated against signature
+ */
+DXXAPILOCAL void wire_swap_body(unsigned char *body, size_t size, const char *signature);
+
+/* D-Bus rules for the contents of strings (UTF-8 without nul, surrogates
+ * or overlong forms), object paths and signatures
+ */
+DXXAPILOCAL bool wire_valid_utf8(const char *chars, size_t length);
+
+DXXAPILOCAL bool wire_valid_path(const char *chars, size_t length);
+
+DXXAPILOCAL bool wire_valid_signature(const char *chars, size_t length);
+
+} /* namespace DBus */
+
+#endif//__DBUSXX_WIRE_P_H
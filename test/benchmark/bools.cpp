@@ -0,0 +1,112 @@
+// Marshalling 65536 flags as ab from std::vector<bool> and std::bitset,
+// through MessageIter and WireWriter, and reading them back.
+
+#include <dbus-c++/dbus.h>
+
+#include <bitset>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+static const size_t flags = 65536;
+static const int rounds = 1000;
+
+static double elapsed_ms(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static DBus::CallMessage make_call()
+{
+  return DBus::CallMessage("org.freedesktop.DBus.Benchmark", "/org/freedesktop/DBus/Benchmark",
+                           "org.freedesktop.DBus.Benchmark", "StateChanged");
+}
+
+int main()
+{
+  vector<bool> mask(flags);
+  static bitset<flags> bits;
+
+  for (size_t i = 0; i < flags; ++i)
+  {
+    mask[i] = (i * 7919) % 3 == 0;
+    bits[i] = mask[i];
+  }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i)
+  {
+    DBus::CallMessage m = make_call();
+    DBus::MessageIter wi = m.writer();
+    wi << mask;
+  }
+  double vector_write_ms = elapsed_ms(start);
+
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i)
+  {
+    DBus::CallMessage m = make_call();
+    DBus::MessageIter wi = m.writer();
+    wi << bits;
+  }
+  double bitset_write_ms = elapsed_ms(start);
+
+  start = chrono::steady_clock::now();
+  size_t wire_size = 0;
+  for (int i = 0; i < rounds; ++i)
+  {
+    DBus::WireWriter w;
+    w << mask;
+    wire_size += w.size();
+  }
+  double wire_write_ms = elapsed_ms(start);
+
+  DBus::CallMessage msg = make_call();
+  DBus::MessageIter wi = msg.writer();
+  wi << mask;
+
+  start = chrono::steady_clock::now();
+  size_t set = 0;
+  for (int i = 0; i < rounds; ++i)
+  {
+    vector<bool> v;
+    DBus::MessageIter ri = msg.reader();
+    ri >> v;
+    set += v[3];
+  }
+  double vector_read_ms = elapsed_ms(start);
+
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i)
+  {
+    bitset<flags> b;
+    DBus::MessageIter ri = msg.reader();
+    ri >> b;
+    set += b[3];
+  }
+  double bitset_read_ms = elapsed_ms(start);
+
+  vector<bool> back;
+  bitset<flags> back_bits;
+  DBus::MessageIter ri = msg.reader();
+  ri >> back;
+  ri = msg.reader();
+  ri >> back_bits;
+
+  if (back != mask || back_bits != bits || wire_size != rounds * (4 + 4 * flags))
+  {
+    fprintf(stderr, "bools: round trip mismatch\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("ab of %zu flags, %d rounds\n", flags, rounds);
+  printf("  vector<bool> to MessageIter    %8.1f ms\n", vector_write_ms);
+  printf("  bitset to MessageIter          %8.1f ms\n", bitset_write_ms);
+  printf("  vector<bool> to WireWriter     %8.1f ms\n", wire_write_ms);
+  printf("  MessageIter to vector<bool>    %8.1f ms\n", vector_read_ms);
+  printf("  MessageIter to bitset          %8.1f ms\n", bitset_read_ms);
+
+  return set ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,163 @@
+// Fixed arrays from a peer of the other byte order: libdbus swapping them
+// (reader) against the copy and swap done when the body is loaded for
+// in-place reading (wire_reader), for 16-, 32- and 64-bit elements.
+// Reading a native-order message is the baseline.
+
+#include <dbus-c++/dbus.h>
+#include <dbus/dbus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+static const int rounds = 10;
+static const size_t bytes = 16 << 20;
+
+static double elapsed_ms(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+struct Marshaller
+{
+  char order;
+  string data;
+
+  void pad(size_t n)
+  {
+    while (data.size() % n) data += '\0';
+  }
+
+  void put(uint64_t v, size_t size)
+  {
+    pad(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+      const size_t shift = order == 'B' ? size - 1 - i : i;
+      data += char(v >> (8 * shift));
+    }
+  }
+
+  void put_signature(const char *sig)
+  {
+    data += char(strlen(sig));
+    data += sig;
+    data += '\0';
+  }
+};
+
+/* a method return carrying a single array of count elements of type t
+ */
+static string marshal(char order, char t, size_t size, size_t count)
+{
+  const char sig[] = { 'a', t, '\0' };
+  Marshaller m = { order, string() };
+
+  m.data += order;
+  m.data += char(DBUS_MESSAGE_TYPE_METHOD_RETURN);
+  m.data += '\0';
+  m.data += char(DBUS_MAJOR_PROTOCOL_VERSION);
+  m.put(0, 4);                  // body length, patched below
+  m.put(1, 4);                  // serial
+  m.put(0, 4);                  // header fields length, patched below
+
+  m.pad(8);
+  m.data += char(DBUS_HEADER_FIELD_REPLY_SERIAL);
+  m.put_signature("u");
+  m.put(1, 4);
+  m.pad(8);
+  m.data += char(DBUS_HEADER_FIELD_SIGNATURE);
+  m.put_signature("g");
+  m.put_signature(sig);
+
+  Marshaller fields = { order, string() };
+  fields.put(m.data.size() - 16, 4);
+  m.data.replace(12, 4, fields.data);
+  m.pad(8);
+
+  const size_t body = m.data.size();
+
+  m.put(size * count, 4);
+  for (size_t i = 0; i < count; ++i)
+    m.put(i, size);
+
+  Marshaller length = { order, string() };
+  length.put(m.data.size() - body, 4);
+  m.data.replace(4, 4, length.data);
+
+  return m.data;
+}
+
+template <typename T>
+static uint64_t read(DBus::MessageIter it)
+{
+  vector<T> v;
+  it >> v;
+
+  uint64_t sum = 0;
+  for (size_t i = 0; i < v.size(); i += 4096)
+    sum += v[i];
+  return sum + v.size();
+}
+
+template <typename T>
+static bool run(char t, char native, char foreign)
+{
+  const size_t count = bytes / sizeof(T);
+  const string native_data = marshal(native, t, sizeof(T), count);
+  const string foreign_data = marshal(foreign, t, sizeof(T), count);
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i)
+    DBus::Message::demarshal(foreign_data.data(), foreign_data.size());
+  double load_ms = elapsed_ms(start);
+
+  start = chrono::steady_clock::now();
+  uint64_t native_sum = 0;
+  for (int i = 0; i < rounds; ++i)
+    native_sum += read<T>(DBus::Message::demarshal(native_data.data(), native_data.size()).reader());
+  double native_ms = elapsed_ms(start) - load_ms;
+
+  start = chrono::steady_clock::now();
+  uint64_t iter_sum = 0;
+  for (int i = 0; i < rounds; ++i)
+    iter_sum += read<T>(DBus::Message::demarshal(foreign_data.data(), foreign_data.size()).reader());
+  double iter_ms = elapsed_ms(start) - load_ms;
+
+  start = chrono::steady_clock::now();
+  uint64_t wire_sum = 0;
+  for (int i = 0; i < rounds; ++i)
+    wire_sum += read<T>(DBus::Message::demarshal(foreign_data.data(), foreign_data.size()).wire_reader());
+  double wire_ms = elapsed_ms(start) - load_ms;
+
+  if (native_sum != iter_sum || native_sum != wire_sum)
+  {
+    fprintf(stderr, "byteswap: %zu-bit values differ\n", sizeof(T) * 8);
+    return false;
+  }
+
+  printf("a%c, %zu elements, %d messages (excluding %.1f ms to load them)\n", t, count, rounds, load_ms);
+  printf("  native order, reader()        %8.1f ms\n", native_ms);
+  printf("  swapped order, reader()       %8.1f ms\n", iter_ms);
+  printf("  swapped order, wire_reader()  %8.1f ms  (%.1fx)\n", wire_ms, iter_ms / wire_ms);
+
+  return true;
+}
+
+int main()
+{
+  const uint16_t probe = 1;
+  const char native = *(const char *)&probe ? 'l' : 'B';
+  const char foreign = native == 'l' ? 'B' : 'l';
+
+  if (!run<uint16_t>('q', native, foreign)
+      || !run<uint32_t>('u', native, foreign)
+      || !run<uint64_t>('t', native, foreign))
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+// Columnar marshalling (DBus::columns) against the DBus::Struct path for an
+// a(iddd) array whose data lives in parallel vectors.
+
+#include <dbus-c++/dbus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+typedef DBus::Struct<int32_t, double, double, double> Row;
+
+static const size_t rows = 1000000;
+
+static double elapsed_ms(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+  vector<int32_t> ids;
+  vector<double> x, y, z;
+
+  for (size_t i = 0; i < rows; ++i)
+  {
+    ids.push_back(i);
+    x.push_back(i * 0.5);
+    y.push_back(i * 0.25);
+    z.push_back(i * 0.125);
+  }
+
+  // write: transpose into structs first, as callers had to before
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  DBus::CallMessage struct_msg;
+  {
+    vector<Row> table(rows);
+    for (size_t i = 0; i < rows; ++i)
+    {
+      table[i]._1 = ids[i];
+      table[i]._2 = x[i];
+      table[i]._3 = y[i];
+      table[i]._4 = z[i];
+    }
+    DBus::MessageIter wi = struct_msg.writer();
+    wi << table;
+  }
+  double struct_write = elapsed_ms(start);
+
+  start = chrono::steady_clock::now();
+  DBus::CallMessage column_msg;
+  {
+    DBus::MessageIter wi = column_msg.writer();
+    wi << DBus::columns(ids, x, y, z);
+  }
+  double column_write = elapsed_ms(start);
+
+  // read: structs then transpose back into columns, or straight into columns
+  start = chrono::steady_clock::now();
+  vector<int32_t> ids1;
+  vector<double> x1, y1, z1;
+  {
+    vector<Row> table;
+    DBus::MessageIter ri = struct_msg.reader();
+    ri >> table;
+    ids1.reserve(table.size());
+    x1.reserve(table.size());
+    y1.reserve(table.size());
+    z1.reserve(table.size());
+    for (vector<Row>::const_iterator it = table.begin(); it != table.end(); ++it)
+    {
+      ids1.push_back(it->_1);
+      x1.push_back(it->_2);
+      y1.push_back(it->_3);
+      z1.push_back(it->_4);
+    }
+  }
+  double struct_read = elapsed_ms(start);
+
+  start = chrono::steady_clock::now();
+  vector<int32_t> ids2;
+  vector<double> x2, y2, z2;
+  {
+    DBus::MessageIter ri = column_msg.reader();
+    ri >> DBus::columns(ids2, x2, y2, z2);
+  }
+  double column_read = elapsed_ms(start);
+
+  if (ids1 != ids || z1 != z || ids2 != ids || x2 != x || y2 != y || z2 != z)
+  {
+    fprintf(stderr, "columns: round trip mismatch\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("a(iddd), %zu rows\n", rows);
+  printf("  write  Struct %8.1f ms   columns %8.1f ms\n", struct_write, column_write);
+  printf("  read   Struct %8.1f ms   columns %8.1f ms\n", struct_read, column_read);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+// Decoding as and a{sas} into std containers against std::pmr containers
+// backed by a monotonic arena released once per call, counting the
+// allocations each of them makes.
+
+#include <dbus-c++/dbus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+  ++allocations;
+  if (void *p = malloc(size ? size : 1))
+    return p;
+  throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+  free(p);
+}
+
+#if __cplusplus >= 201703L
+// std::pmr::new_delete_resource() allocates through these
+void *operator new(size_t size, align_val_t align)
+{
+  ++allocations;
+  if (void *p = aligned_alloc(size_t(align), (size + size_t(align) - 1) & ~(size_t(align) - 1)))
+    return p;
+  throw bad_alloc();
+}
+
+void operator delete(void *p, align_val_t) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t, align_val_t) noexcept
+{
+  free(p);
+}
+#endif
+
+#ifdef DBUSXX_HAS_PMR
+
+static const int rounds = 500;
+
+static double elapsed_ms(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+  vector<string> names(200, "org.freedesktop.DBus.Benchmark.Name");
+  map< string, vector<string> > groups;
+
+  for (int i = 0; i < 100; ++i)
+    groups["group name number " + to_string(i)] = vector<string>(20, "a member name longer than inline");
+
+  DBus::CallMessage msg("org.freedesktop.DBus.Benchmark", "/org/freedesktop/DBus/Benchmark",
+                        "org.freedesktop.DBus.Benchmark", "Groups");
+  DBus::MessageIter wi = msg.writer();
+  wi << names << groups;
+
+  size_t start_allocations = allocations;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  size_t std_count = 0;
+  for (int i = 0; i < rounds; ++i)
+  {
+    vector<string> n;
+    map< string, vector<string> > g;
+    DBus::MessageIter ri = msg.reader();
+    ri >> n >> g;
+    std_count += n.size() + g.size();
+  }
+  double std_ms = elapsed_ms(start);
+  size_t std_allocations = allocations - start_allocations;
+
+  char buffer[64 * 1024];
+  start_allocations = allocations;
+  start = chrono::steady_clock::now();
+  size_t pmr_count = 0;
+  for (int i = 0; i < rounds; ++i)
+  {
+    pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+    pmr::vector<pmr::string> n(&arena);
+    pmr::map< pmr::string, pmr::vector<pmr::string> > g(&arena);
+    DBus::MessageIter ri = msg.reader();
+    ri >> n >> g;
+    pmr_count += n.size() + g.size();
+  }
+  double pmr_ms = elapsed_ms(start);
+  size_t pmr_allocations = allocations - start_allocations;
+
+  if (std_count != pmr_count)
+  {
+    fprintf(stderr, "pmr: element count mismatch\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("as[200] + a{sas}[100x20], %d calls\n", rounds);
+  printf("  std containers         %8.1f ms  %6zu allocations per call\n", std_ms, std_allocations / rounds);
+  printf("  pmr + monotonic arena  %8.1f ms  %6zu allocations per call\n", pmr_ms, pmr_allocations / rounds);
+
+  return EXIT_SUCCESS;
+}
+
+#else
+
+int main()
+{
+  printf("pmr: needs C++17, skipped\n");
+  return EXIT_SUCCESS;
+}
+
+#endif//DBUSXX_HAS_PMR
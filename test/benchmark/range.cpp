@@ -0,0 +1,109 @@
+// Summing an a(is) of 200000 rows read into a std::vector first against
+// reading it lazily through DBus::ArrayRange, and writing the same rows from
+// a generator through DBus::ArrayInserter against filling a vector first.
+
+#include <dbus-c++/dbus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+typedef tuple<int32_t, string> Row;
+
+static const int rows = 200000;
+static const int rounds = 10;
+
+static double elapsed_ms(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static DBus::CallMessage make_call()
+{
+  return DBus::CallMessage("org.freedesktop.DBus.Benchmark", "/org/freedesktop/DBus/Benchmark",
+                           "org.freedesktop.DBus.Benchmark", "Rows");
+}
+
+static Row make_row(int i)
+{
+  return Row(i, "row name");
+}
+
+int main()
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r)
+  {
+    vector<Row> v;
+    for (int i = 0; i < rows; ++i)
+      v.push_back(make_row(i));
+
+    DBus::CallMessage m = make_call();
+    DBus::MessageIter wi = m.writer();
+    wi << v;
+  }
+  double vector_write_ms = elapsed_ms(start);
+
+  start = chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r)
+  {
+    DBus::CallMessage m = make_call();
+    DBus::MessageIter wi = m.writer();
+    DBus::MessageIter ait = wi.new_array("(is)");
+    DBus::ArrayInserter<Row> out(ait);
+    for (int i = 0; i < rows; ++i)
+      *out++ = make_row(i);
+    wi.close_container(ait);
+  }
+  double insert_ms = elapsed_ms(start);
+
+  DBus::CallMessage msg = make_call();
+  {
+    DBus::MessageIter wi = msg.writer();
+    DBus::MessageIter ait = wi.new_array("(is)");
+    DBus::ArrayInserter<Row> out(ait);
+    for (int i = 0; i < rows; ++i)
+      *out++ = make_row(i);
+    wi.close_container(ait);
+  }
+
+  start = chrono::steady_clock::now();
+  int64_t vector_sum = 0;
+  for (int r = 0; r < rounds; ++r)
+  {
+    DBus::MessageIter ri = msg.reader();
+    vector<Row> v;
+    ri >> v;
+    for (size_t i = 0; i < v.size(); ++i)
+      vector_sum += get<0>(v[i]);
+  }
+  double vector_read_ms = elapsed_ms(start);
+
+  start = chrono::steady_clock::now();
+  int64_t range_sum = 0;
+  for (int r = 0; r < rounds; ++r)
+  {
+    DBus::MessageIter ri = msg.reader();
+    DBus::ArrayRange<Row> range;
+    ri >> range;
+    for (DBus::ArrayRange<Row>::iterator i = range.begin(); i != range.end(); ++i)
+      range_sum += get<0>(*i);
+  }
+  double range_read_ms = elapsed_ms(start);
+
+  if (vector_sum != range_sum || vector_sum != int64_t(rounds) * rows * (rows - 1) / 2)
+  {
+    fprintf(stderr, "range: sum mismatch\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("a(is) with %d rows, %d rounds\n", rows, rounds);
+  printf("  write from std::vector   %8.1f ms\n", vector_write_ms);
+  printf("  write via ArrayInserter  %8.1f ms\n", insert_ms);
+  printf("  read into std::vector    %8.1f ms\n", vector_read_ms);
+  printf("  read via ArrayRange      %8.1f ms\n", range_read_ms);
+
+  return EXIT_SUCCESS;
+}
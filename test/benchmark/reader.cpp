@@ -0,0 +1,117 @@
+// In-place body reader (Message::wire_reader) against the libdbus-backed
+// MessageIter for a large reply: a(isd) and as with 50000 entries each.
+// Then small as bodies, where marshalling the copy wire_reader() reads
+// may cost more than it saves, and what unchecked_reader() picks for them.
+
+#include <dbus-c++/dbus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+static const int rounds = 20;
+static const int entries = 50000;
+
+static double elapsed_ms(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+struct Reply
+{
+  vector< tuple<int32_t, string, double> > rows;
+  vector<string> names;
+};
+
+static size_t read(DBus::MessageIter it)
+{
+  Reply r;
+
+  it >> r.rows >> r.names;
+  return r.rows.size() + r.names.size();
+}
+
+int main()
+{
+  Reply r;
+
+  for (int i = 0; i < entries; ++i)
+  {
+    r.rows.push_back(make_tuple(i, string("row name"), i * 0.5));
+    r.names.push_back("org.freedesktop.DBus.Name");
+  }
+
+  DBus::CallMessage head("org.freedesktop.DBus.Benchmark", "/org/freedesktop/DBus/Benchmark",
+                         "org.freedesktop.DBus.Benchmark", "Get");
+  DBus::WireWriter w;
+  w << r.rows << r.names;
+  DBus::Message reply = w.message(head);
+
+  // every round reads a fresh message so wire_reader() pays for marshalling
+  vector<DBus::Message> iter_msgs, wire_msgs;
+  for (int i = 0; i < rounds; ++i)
+  {
+    iter_msgs.push_back(reply.copy());
+    wire_msgs.push_back(reply.copy());
+  }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  size_t iter_count = 0;
+  for (int i = 0; i < rounds; ++i)
+    iter_count += read(iter_msgs[i].reader());
+  double iter_ms = elapsed_ms(start);
+
+  start = chrono::steady_clock::now();
+  size_t wire_count = 0;
+  for (int i = 0; i < rounds; ++i)
+    wire_count += read(wire_msgs[i].wire_reader());
+  double wire_ms = elapsed_ms(start);
+
+  if (iter_count != wire_count)
+  {
+    fprintf(stderr, "reader: element count mismatch\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("a(isd) + as reply, %zu byte body, %d messages\n", w.size(), rounds);
+  printf("  reader()       %8.1f ms\n", iter_ms);
+  printf("  wire_reader()  %8.1f ms  (%.1fx)\n", wire_ms, iter_ms / wire_ms);
+
+  printf("as reply, microseconds per message\n");
+  printf("  body   reader()  wire_reader()  unchecked_reader()\n");
+
+  for (int names = 1; names <= 32; names *= 2)
+  {
+    const int small_rounds = 100000;
+
+    DBus::WireWriter sw;
+    sw << vector<string>(names, "name.x");
+    DBus::Message small = sw.message(head);
+
+    double us[3];
+
+    for (int how = 0; how < 3; ++how)
+    {
+      vector<DBus::Message> msgs;
+      for (int i = 0; i < small_rounds; ++i)
+        msgs.push_back(small.copy());
+
+      start = chrono::steady_clock::now();
+      for (int i = 0; i < small_rounds; ++i)
+      {
+        DBus::MessageIter it = how == 0 ? msgs[i].reader()
+                               : how == 1 ? msgs[i].wire_reader()
+                               : msgs[i].unchecked_reader("as");
+        vector<string> v;
+        it >> v;
+      }
+      us[how] = elapsed_ms(start) * 1000 / small_rounds;
+    }
+
+    printf("  %4zu  %8.2f  %13.2f  %18.2f\n", sw.size(), us[0], us[1], us[2]);
+  }
+
+  return EXIT_SUCCESS;
+}
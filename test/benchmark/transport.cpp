@@ -0,0 +1,406 @@
+// Native transport against libdbus's connection layer, talking to a
+// DBus::Server peer in a child process: round-trip latency of small method
+// calls, and throughput of 1 KiB signals sent to and received from the
+// peer, sending them one at a time, in bursts through send_batch() and
+// through a corked connection; and the round trip while another thread
+// floods the connection with signals, with and without priority lanes.
+
+#include <dbus-c++/dbus.h>
+#include <dbus-c++/eventloop-integration.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+
+#include <pthread.h>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+static const int calls = 5000;
+static const int signals = 20000;
+static const int burst = 200;
+static const unsigned int cork_budget_us = 500;
+static const int flooded_calls = 1000;
+
+static const char *const interface_name = "org.freedesktop.DBus.Benchmark";
+
+static double elapsed_ms(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static DBus::BusDispatcher dispatcher;
+
+static bool is_call(const DBus::Message &m, const char *member)
+{
+  static const int call_type = DBus::CallMessage().type();
+  const DBus::CallMessage &call = static_cast<const DBus::CallMessage &>(m);
+
+  return m.type() == call_type && !strcmp(call.interface(), interface_name) && !strcmp(call.member(), member);
+}
+
+static void fill(DBus::Message &msg)
+{
+  DBus::MessageIter wi = msg.writer();
+  wi << int32_t(0) << vector<double>(128, 0.5);
+}
+
+/* replies to Echo, counts Tick signals, returns and resets the count on
+ * Ticks, and answers Burst with that many signals followed by the reply
+ */
+class Peer : public DBus::Server
+{
+public:
+
+  Peer(const char *address) : DBus::Server(address), ticks(0)
+  {}
+
+private:
+
+  void on_new_connection(DBus::Connection &c)
+  {
+    conns.push_back(c);
+    slots.push_back(DBus::MessageSlot());
+    slots.back() = new DBus::Callback<Peer, bool, const DBus::Message &>(this, &Peer::filter);
+    conns.back().add_filter(slots.back());
+  }
+
+  bool filter(const DBus::Message &m)
+  {
+    DBus::Connection &conn = conns.back();
+
+    if (m.is_signal(interface_name, "Tick"))
+    {
+      ++ticks;
+      return true;
+    }
+
+    const bool echo = is_call(m, "Echo");
+    const bool count = is_call(m, "Ticks");
+
+    if (!echo && !count && !is_call(m, "Burst"))
+      return false;
+
+    const DBus::CallMessage &call = static_cast<const DBus::CallMessage &>(m);
+    DBus::ReturnMessage reply(call);
+    DBus::MessageIter ri = call.reader();
+
+    if (count)
+    {
+      DBus::MessageIter wi = reply.writer();
+
+      wi << int32_t(ticks);
+      ticks = 0;
+    }
+    else if (echo)
+    {
+      string text;
+
+      ri >> text;
+
+      DBus::MessageIter wi = reply.writer();
+      wi << text;
+    }
+    else
+    {
+      uint32_t count;
+
+      ri >> count;
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        DBus::SignalMessage sig("/org/freedesktop/DBus/Benchmark", interface_name, "Tock");
+
+        fill(sig);
+        conn.send(sig);
+      }
+    }
+
+    conn.send(reply);
+    return true;
+  }
+
+  int ticks;
+  list<DBus::Connection> conns;
+  list<DBus::MessageSlot> slots;
+};
+
+struct Counter
+{
+  int tocks;
+
+  bool filter(const DBus::Message &m)
+  {
+    if (!m.is_signal(interface_name, "Tock"))
+      return false;
+
+    DBus::MessageIter ri = m.wire_reader();
+    int32_t n;
+    vector<double> values;
+
+    ri >> n >> values;
+    tocks += values.size() == 128;
+    return true;
+  }
+};
+
+static DBus::CallMessage call(const char *method)
+{
+  return DBus::CallMessage(NULL, "/org/freedesktop/DBus/Benchmark", interface_name, method);
+}
+
+/* the peer handles messages in order, so this returns after the last tick
+ */
+static int32_t ticks(DBus::Connection &conn)
+{
+  DBus::CallMessage sync = call("Ticks");
+  DBus::Message reply = conn.send_blocking(sync);
+  DBus::MessageIter ri = reply.reader();
+  int32_t seen;
+
+  ri >> seen;
+  return seen;
+}
+
+static double sync_ticks(DBus::Connection &conn)
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  const int32_t seen = ticks(conn);
+  const double ms = elapsed_ms(start);
+
+  if (seen != signals)
+  {
+    fprintf(stderr, "transport: peer saw %d of %d signals\n", seen, signals);
+    exit(EXIT_FAILURE);
+  }
+  return ms;
+}
+
+struct Result
+{
+  double latency_us;
+  double send_ms;
+  double batch_ms;
+  double corked_ms;
+  double receive_ms;
+};
+
+static Result run(DBus::Connection conn)
+{
+  Result r;
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int i = 0; i < calls; ++i)
+  {
+    DBus::CallMessage echo = call("Echo");
+    DBus::MessageIter wi = echo.writer();
+
+    wi << string("ping");
+    conn.send_blocking(echo);
+  }
+  r.latency_us = elapsed_ms(start) * 1000 / calls;
+
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < signals; ++i)
+  {
+    DBus::SignalMessage sig("/org/freedesktop/DBus/Benchmark", interface_name, "Tick");
+
+    fill(sig);
+    conn.send(sig);
+  }
+  r.send_ms = elapsed_ms(start) + sync_ticks(conn);
+
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < signals; i += burst)
+  {
+    vector<DBus::Message> batch;
+
+    for (int j = 0; j < burst; ++j)
+    {
+      DBus::SignalMessage sig("/org/freedesktop/DBus/Benchmark", interface_name, "Tick");
+
+      fill(sig);
+      batch.push_back(sig);
+    }
+    conn.send_batch(batch);
+  }
+  r.batch_ms = elapsed_ms(start) + sync_ticks(conn);
+
+  r.corked_ms = 0;
+  if (conn.set_cork(cork_budget_us))
+  {
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < signals; ++i)
+    {
+      DBus::SignalMessage sig("/org/freedesktop/DBus/Benchmark", interface_name, "Tick");
+
+      fill(sig);
+      conn.send(sig);
+    }
+    r.corked_ms = elapsed_ms(start) + sync_ticks(conn);
+    conn.set_cork(0);
+  }
+
+  Counter counter = { 0 };
+  DBus::MessageSlot slot;
+  slot = new DBus::Callback<Counter, bool, const DBus::Message &>(&counter, &Counter::filter);
+  conn.add_filter(slot);
+
+  start = chrono::steady_clock::now();
+  DBus::CallMessage burst = call("Burst");
+  DBus::MessageIter bi = burst.writer();
+  bi << uint32_t(signals);
+  conn.send_blocking(burst);
+  dispatcher.dispatch_pending();
+  r.receive_ms = elapsed_ms(start);
+
+  conn.remove_filter(slot);
+
+  if (counter.tocks != signals)
+  {
+    fprintf(stderr, "transport: received %d of %d signals\n", counter.tocks, signals);
+    exit(EXIT_FAILURE);
+  }
+
+  return r;
+}
+
+/* sends batches of signals until stopped, as a telemetry burst would
+ */
+struct Flood
+{
+  DBus::Connection *conn;
+  atomic<bool> stop;
+
+  static void *run(void *data)
+  {
+    Flood *flood = static_cast<Flood *>(data);
+    DBus::SignalMessage sig("/org/freedesktop/DBus/Benchmark", interface_name, "Tick");
+
+    fill(sig);
+    while (!flood->stop)
+    {
+      vector<DBus::Message> batch;
+
+      for (int i = 0; i < burst; ++i)
+        batch.push_back(sig.copy());
+      flood->conn->send_batch(batch);
+    }
+    return NULL;
+  }
+};
+
+struct Percentiles
+{
+  double p50_us;
+  double p99_us;
+};
+
+static Percentiles flooded(DBus::Connection conn, bool lanes)
+{
+  conn.set_priority_lanes(lanes);
+
+  Flood flood;
+  flood.conn = &conn;
+  flood.stop = false;
+
+  pthread_t thread;
+  pthread_create(&thread, NULL, Flood::run, &flood);
+
+  vector<double> samples;
+
+  for (int i = 0; i < flooded_calls; ++i)
+  {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    DBus::CallMessage echo = call("Echo");
+    DBus::MessageIter wi = echo.writer();
+
+    wi << string("ping");
+    conn.send_blocking(echo);
+    samples.push_back(elapsed_ms(start) * 1000);
+  }
+
+  flood.stop = true;
+  pthread_join(thread, NULL);
+  ticks(conn);
+  conn.set_priority_lanes(false);
+
+  sort(samples.begin(), samples.end());
+
+  Percentiles p = { samples[samples.size() / 2], samples[samples.size() * 99 / 100] };
+  return p;
+}
+
+int main()
+{
+  DBus::_init_threading();
+  DBus::default_dispatcher = &dispatcher;
+
+  char address[128];
+  snprintf(address, sizeof(address), "unix:path=/tmp/dbuscxx-benchmark-%d", (int)getpid());
+
+  int ready[2];
+  if (pipe(ready) < 0)
+    return EXIT_FAILURE;
+
+  const pid_t child = fork();
+
+  if (child == 0)
+  {
+    Peer peer(address);
+
+    close(ready[0]);
+    close(ready[1]);
+    dispatcher.enter();
+    _exit(EXIT_SUCCESS);
+  }
+
+  // the child closes its end once it listens
+  char byte;
+  close(ready[1]);
+  if (read(ready[0], &byte, 1) != 0)
+    return EXIT_FAILURE;
+
+  Result lib, native;
+  Percentiles fifo, lanes;
+  {
+    DBus::Connection conn(address);
+    lib = run(conn);
+    conn.disconnect();
+    dispatcher.dispatch_pending();
+  }
+  {
+    DBus::Connection conn(address, true, DBus::Connection::Native);
+    native = run(conn);
+    fifo = flooded(conn, false);
+    lanes = flooded(conn, true);
+    conn.disconnect();
+    dispatcher.dispatch_pending();
+  }
+
+  kill(child, SIGTERM);
+  waitpid(child, NULL, 0);
+  unlink(address + strlen("unix:path="));
+
+  printf("peer-to-peer over a unix socket, %d calls, %d x 1 KiB signals each way\n", calls, signals);
+  printf("                        libdbus      native\n");
+  printf("  round trip      %9.1f us %9.1f us  (%.1fx)\n", lib.latency_us, native.latency_us, lib.latency_us / native.latency_us);
+  printf("  send            %9.1f ms %9.1f ms  (%.1fx)\n", lib.send_ms, native.send_ms, lib.send_ms / native.send_ms);
+  printf("  batched x%-4d   %9.1f ms %9.1f ms  (%.1fx)\n", burst, lib.batch_ms, native.batch_ms, lib.batch_ms / native.batch_ms);
+  printf("  corked %3u us   %9s    %9.1f ms  (%.1fx over send)\n", cork_budget_us, "-", native.corked_ms, native.send_ms / native.corked_ms);
+  printf("  receive         %9.1f ms %9.1f ms  (%.1fx)\n", lib.receive_ms, native.receive_ms, lib.receive_ms / native.receive_ms);
+
+  printf("native round trip under a flood of %d x 1 KiB batches, %d calls\n", burst, flooded_calls);
+  printf("                         median         p99\n");
+  printf("  one queue       %9.1f us %9.1f us\n", fifo.p50_us, fifo.p99_us);
+  printf("  priority lanes  %9.1f us %9.1f us  (%.1fx)\n", lanes.p50_us, lanes.p99_us, fifo.p99_us / lanes.p99_us);
+
+  return EXIT_SUCCESS;
+}
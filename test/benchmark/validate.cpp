@@ -0,0 +1,77 @@
+// Cost of validating strings before they are marshalled: a large `as` and a
+// long text with some non-ASCII content, written through MessageIter with and
+// without validating mode, and through WireWriter with and without
+// trusted-input mode.
+
+#include <dbus-c++/dbus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+static const int rounds = 20;
+
+static double elapsed_ms(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+struct Payload
+{
+  vector<string> names;
+  string text;
+};
+
+static double write_iter(const Payload &p, bool validating)
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  for (int i = 0; i < rounds; ++i)
+  {
+    DBus::CallMessage call("org.freedesktop.DBus.Benchmark", "/org/freedesktop/DBus/Benchmark",
+                           "org.freedesktop.DBus.Benchmark", "Put");
+    DBus::MessageIter wi = call.writer();
+    wi.validating(validating);
+    wi << p.names << p.text;
+  }
+  return elapsed_ms(start);
+}
+
+static double write_wire(const Payload &p, bool trusted)
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  for (int i = 0; i < rounds; ++i)
+  {
+    DBus::WireWriter w;
+    w.trusted(trusted);
+    w << p.names << p.text;
+  }
+  return elapsed_ms(start);
+}
+
+int main()
+{
+  Payload p;
+
+  for (int i = 0; i < 100000; ++i)
+    p.names.push_back("org.freedesktop.DBus.Benchmark.Name");
+
+  for (int i = 0; i < 100000; ++i)
+    p.text += i % 10 ? "plain ascii text " : "ça coûte €5 ";
+
+  const double iter_ms = write_iter(p, false);
+  const double iter_validating_ms = write_iter(p, true);
+  const double wire_ms = write_wire(p, false);
+  const double wire_trusted_ms = write_wire(p, true);
+
+  printf("as of %zu names + %zu byte text, %d messages\n", p.names.size(), p.text.size(), rounds);
+  printf("  MessageIter               %8.1f ms\n", iter_ms);
+  printf("  MessageIter, validating   %8.1f ms\n", iter_validating_ms);
+  printf("  WireWriter                %8.1f ms\n", wire_ms);
+  printf("  WireWriter, trusted       %8.1f ms\n", wire_trusted_ms);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,695 @@
+// Functional tests of the native transport. Peer-to-peer, against a
+// scripted peer on a unix socket: authentication that is rejected, a peer
+// hanging up while a large message is written, and a frame larger than
+// the connection accepts, and try_send() while the peer does not read, on
+// both transports; against a DBus::Server peer, replies reaching
+// the thread that waits for them while signals interleave. With "session"
+// as argument, run under dbus-run-session, the same routing goes through
+// dbus-daemon, to an object adaptor on a native connection as well.
+
+#include <dbus-c++/dbus.h>
+#include <dbus-c++/eventloop-integration.h>
+
+#include <dbus/dbus.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <string>
+
+#include <pthread.h>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+static const char *const interface_name = "org.freedesktop.DBus.Test.Native";
+static const char *const object_path = "/org/freedesktop/DBus/Test/Native";
+
+static const int threads = 4;
+static const int calls = 200;
+static const int noise = 3;
+static const double prompt_ms = 1000;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); ++failures; } } while (0)
+
+static double elapsed_ms(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static DBus::BusDispatcher dispatcher;
+static pthread_t dispatch_thread;
+static bool dispatching = false;
+
+static void *dispatch(void *)
+{
+  dispatcher.enter();
+  return NULL;
+}
+
+/* BusDispatcher only looks at watches added while it waits once something
+ * wakes it up, so a test starts it after setting up what it has to watch
+ */
+static void start_dispatching()
+{
+  dispatching = true;
+  pthread_create(&dispatch_thread, NULL, dispatch, NULL);
+}
+
+/* the dispatcher may still hold a connection in its queue after the last
+ * reference is gone, so what a test sets up lives until it has stopped
+ */
+static list<DBus::Connection *> connections;
+static list<DBus::Server *> servers;
+
+static DBus::Connection &kept(DBus::Connection *conn)
+{
+  connections.push_back(conn);
+  return *conn;
+}
+
+static string socket_address(const char *name)
+{
+  char path[108];
+
+  snprintf(path, sizeof(path), "/tmp/dbuscxx-native-%d-%s", (int)getpid(), name);
+  return string("unix:path=") + path;
+}
+
+static bool is_call(const DBus::Message &m, const char *member)
+{
+  static const int call_type = DBus::CallMessage().type();
+  const DBus::CallMessage &call = static_cast<const DBus::CallMessage &>(m);
+
+  return m.type() == call_type && call.interface() && !strcmp(call.interface(), interface_name)
+         && !strcmp(call.member(), member);
+}
+
+static DBus::CallMessage echo_call(const char *destination, const string &text)
+{
+  DBus::CallMessage call(destination, object_path, interface_name, "Echo");
+  DBus::MessageIter wi = call.writer();
+
+  wi << text;
+  return call;
+}
+
+/* plays the server side of a connection by hand: accepts one client,
+ * answers its AUTH line and then does what the test needs
+ */
+class ScriptedPeer
+{
+public:
+
+  enum Script
+  {
+    Reject,     // refuses the authentication
+    Hangup,     // reads hangup_after bytes, then closes
+    Oversize,   // sends a frame announcing oversize_body bytes of body
+    Stall       // reads nothing until release()
+  };
+
+  static const size_t hangup_after = 64 * 1024;
+  static const uint32_t oversize_body = 1 << 20;
+
+  ScriptedPeer(const char *name, Script script)
+    : address(socket_address(name)), _script(script)
+  {
+    struct sockaddr_un sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strncpy(sa.sun_path, address.c_str() + strlen("unix:path="), sizeof(sa.sun_path) - 1);
+    unlink(sa.sun_path);
+
+    _listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listener < 0 || bind(_listener, (struct sockaddr *)&sa, sizeof(sa)) || listen(_listener, 1)
+        || pipe(_release))
+    {
+      perror("scripted peer");
+      exit(1);
+    }
+    pthread_create(&_thread, NULL, run, this);
+  }
+
+  ~ScriptedPeer()
+  {
+    release();
+    pthread_join(_thread, NULL);
+    close(_listener);
+    close(_release[0]);
+    close(_release[1]);
+    unlink(address.c_str() + strlen("unix:path="));
+  }
+
+  void release()
+  {
+    write_string(_release[1], "x");
+  }
+
+  const string address;
+
+private:
+
+  static void *run(void *self)
+  {
+    static_cast<ScriptedPeer *>(self)->play();
+    return NULL;
+  }
+
+  bool read_line(int fd, string &line)
+  {
+    char c;
+
+    line.clear();
+    while (line.size() < 2 || line.compare(line.size() - 2, 2, "\r\n"))
+    {
+      if (read(fd, &c, 1) != 1)
+        return false;
+      line += c;
+    }
+    line.erase(line.size() - 2);
+    return true;
+  }
+
+  void write_string(int fd, const char *s)
+  {
+    if (write(fd, s, strlen(s)) < 0)
+      perror("scripted peer");
+  }
+
+  void play()
+  {
+    const int fd = accept(_listener, NULL, NULL);
+    string line;
+
+    if (fd < 0 || !read_line(fd, line))
+    {
+      close(fd);
+      return;
+    }
+
+    if (_script == Reject)
+    {
+      write_string(fd, "REJECTED EXTERNAL\r\n");
+      read_line(fd, line);
+      close(fd);
+      return;
+    }
+
+    write_string(fd, "OK 0123456789abcdef0123456789abcdef\r\n");
+
+    // libdbus asks for unix fds before it begins
+    while (read_line(fd, line) && line != "BEGIN")
+      write_string(fd, "ERROR\r\n");
+
+    char chunk[4096];
+
+    if (_script == Hangup)
+    {
+      size_t total = 0;
+      ssize_t n;
+
+      while (total < hangup_after && (n = read(fd, chunk, sizeof(chunk))) > 0)
+        total += n;
+      close(fd);
+      return;
+    }
+
+    if (_script == Stall)
+    {
+      struct pollfd p = { _release[0], POLLIN, 0 };
+
+      poll(&p, 1, -1);
+    }
+    else
+    {
+      // a little-endian signal header with no fields and a large body
+      const unsigned char header[16] =
+      {
+        'l', DBUS_MESSAGE_TYPE_SIGNAL, 0, 1,
+        oversize_body & 0xff, (oversize_body >> 8) & 0xff, (oversize_body >> 16) & 0xff, oversize_body >> 24,
+        1, 0, 0, 0,
+        0, 0, 0, 0
+      };
+
+      if (write(fd, header, sizeof(header)) < 0)
+        perror("scripted peer");
+    }
+
+    while (read(fd, chunk, sizeof(chunk)) > 0)
+      ;
+    close(fd);
+  }
+
+  Script _script;
+  int _listener;
+  int _release[2];
+  pthread_t _thread;
+};
+
+/* replies to Echo with its argument after a few Noise signals, and to
+ * Fail with an error
+ */
+class EchoPeer : public DBus::Server
+{
+public:
+
+  EchoPeer(const char *address) : DBus::Server(address)
+  {}
+
+  ~EchoPeer()
+  {
+    for (list<Handler *>::iterator h = _handlers.begin(); h != _handlers.end(); ++h)
+      delete *h;
+  }
+
+private:
+
+  struct Handler
+  {
+    Handler(DBus::Connection &c) : conn(c)
+    {
+      slot = new DBus::Callback<Handler, bool, const DBus::Message &>(this, &Handler::filter);
+      conn.add_filter(slot);
+    }
+
+    bool filter(const DBus::Message &m)
+    {
+      const DBus::CallMessage &call = static_cast<const DBus::CallMessage &>(m);
+
+      if (is_call(m, "Fail"))
+      {
+        DBus::ErrorMessage error(call, DBUS_ERROR_INVALID_ARGS, "failed on request");
+
+        conn.send(error);
+        return true;
+      }
+
+      if (!is_call(m, "Echo"))
+        return false;
+
+      for (int i = 0; i < noise; ++i)
+      {
+        DBus::SignalMessage sig(object_path, interface_name, "Noise");
+
+        conn.send(sig);
+      }
+
+      DBus::MessageIter ri = call.reader();
+      string text;
+
+      ri >> text;
+
+      DBus::ReturnMessage reply(call);
+      DBus::MessageIter wi = reply.writer();
+
+      wi << text;
+      conn.send(reply);
+      return true;
+    }
+
+    DBus::Connection conn;
+    DBus::MessageSlot slot;
+  };
+
+  void on_new_connection(DBus::Connection &c)
+  {
+    _handlers.push_back(new Handler(c));
+  }
+
+  list<Handler *> _handlers;
+};
+
+/* the same Echo, as an object on a native connection
+ */
+class EchoAdaptor : public DBus::InterfaceAdaptor, public DBus::ObjectAdaptor
+{
+public:
+
+  EchoAdaptor(DBus::Connection &conn)
+    : DBus::InterfaceAdaptor(interface_name), DBus::ObjectAdaptor(conn, object_path)
+  {
+    register_method(EchoAdaptor, Echo, Echo);
+  }
+
+  DBus::Message Echo(const DBus::CallMessage &call)
+  {
+    DBus::MessageIter ri = call.reader();
+    string text;
+
+    ri >> text;
+
+    DBus::ReturnMessage reply(call);
+    DBus::MessageIter wi = reply.writer();
+
+    wi << text;
+    return reply;
+  }
+};
+
+struct NoiseCounter
+{
+  NoiseCounter(DBus::Connection &c) : conn(c), count(0)
+  {
+    slot = new DBus::Callback<NoiseCounter, bool, const DBus::Message &>(this, &NoiseCounter::filter);
+    conn.add_filter(slot);
+  }
+
+  ~NoiseCounter()
+  {
+    conn.remove_filter(slot);
+  }
+
+  bool filter(const DBus::Message &m)
+  {
+    if (!m.is_signal(interface_name, "Noise"))
+      return false;
+    ++count;
+    return true;
+  }
+
+  DBus::Connection conn;
+  DBus::MessageSlot slot;
+  atomic<int> count;
+};
+
+struct Caller
+{
+  DBus::Connection *conn;
+  const char *destination;
+  int id;
+  int mismatches;
+};
+
+static void *call_echo(void *arg)
+{
+  Caller *caller = static_cast<Caller *>(arg);
+
+  caller->mismatches = 0;
+  for (int i = 0; i < calls; ++i)
+  {
+    char text[32];
+
+    snprintf(text, sizeof(text), "caller %d call %d", caller->id, i);
+
+    DBus::CallMessage call = echo_call(caller->destination, text);
+
+    try
+    {
+      DBus::Message reply = caller->conn->send_blocking(call, 5000);
+      DBus::MessageIter ri = reply.reader();
+      string got;
+
+      ri >> got;
+      if (got != text)
+        ++caller->mismatches;
+    }
+    catch (DBus::Error &e)
+    {
+      fprintf(stderr, "%s: %s\n", text, e.message());
+      ++caller->mismatches;
+    }
+  }
+  return NULL;
+}
+
+/* several threads wait on the same connection, each for its own replies
+ */
+static void concurrent_echo(DBus::Connection &conn, const char *destination)
+{
+  pthread_t thread[threads];
+  Caller caller[threads];
+
+  for (int t = 0; t < threads; ++t)
+  {
+    caller[t].conn = &conn;
+    caller[t].destination = destination;
+    caller[t].id = t;
+    pthread_create(&thread[t], NULL, call_echo, &caller[t]);
+  }
+  for (int t = 0; t < threads; ++t)
+  {
+    pthread_join(thread[t], NULL);
+    CHECK(caller[t].mismatches == 0);
+  }
+}
+
+static void auth_failure()
+{
+  ScriptedPeer peer("reject", ScriptedPeer::Reject);
+  bool thrown = false;
+
+  try
+  {
+    kept(new DBus::Connection(peer.address.c_str(), true, DBus::Connection::Native));
+  }
+  catch (DBus::Error &e)
+  {
+    thrown = !strcmp(e.name(), DBUS_ERROR_AUTH_FAILED);
+  }
+  CHECK(thrown);
+}
+
+static void disconnect_during_send()
+{
+  ScriptedPeer peer("hangup", ScriptedPeer::Hangup);
+  DBus::Connection &conn = kept(new DBus::Connection(peer.address.c_str(), true, DBus::Connection::Native));
+
+  // far more than the socket buffers, so the peer hangs up mid-write
+  DBus::CallMessage call = echo_call(NULL, string(8 << 20, 'x'));
+  bool thrown = false;
+
+  try
+  {
+    conn.send_blocking(call, 5000);
+  }
+  catch (DBus::Error &e)
+  {
+    thrown = !strcmp(e.name(), DBUS_ERROR_DISCONNECTED);
+  }
+  CHECK(thrown);
+  CHECK(!conn.connected());
+
+  DBus::CallMessage after = echo_call(NULL, "after");
+
+  CHECK(!conn.send(after));
+}
+
+static void oversized_frame()
+{
+  ScriptedPeer peer("oversize", ScriptedPeer::Oversize);
+  DBus::Connection &conn = kept(new DBus::Connection(peer.address.c_str(), true, DBus::Connection::Native));
+
+  conn.set_max_message_size(ScriptedPeer::oversize_body / 2);
+
+  DBus::CallMessage call = echo_call(NULL, "oversize");
+  bool thrown = false;
+
+  try
+  {
+    conn.send_blocking(call, 5000);
+  }
+  catch (DBus::Error &e)
+  {
+    thrown = !strcmp(e.name(), DBUS_ERROR_DISCONNECTED);
+  }
+  CHECK(thrown);
+  CHECK(!conn.connected());
+}
+
+/* try_send() leaves what the socket does not take to the dispatcher, so
+ * it returns at once however large the message, and refuses while the
+ * queue is above its high mark; message marks need a native connection
+ */
+static void try_send_stalled(DBus::Connection::Transport transport)
+{
+  ScriptedPeer peer("stall", ScriptedPeer::Stall);
+  DBus::Connection &conn = kept(new DBus::Connection(peer.address.c_str(), true, transport));
+
+  // libdbus does not count the messages it queues
+  CHECK(conn.set_watermarks(1 << 20, 64 << 10, 1024, 512) == (transport == DBus::Connection::Native));
+  CHECK(conn.set_watermarks(1 << 20, 64 << 10));
+
+  DBus::SignalMessage big(object_path, interface_name, "Big");
+  DBus::MessageIter wi = big.writer();
+
+  wi << string(4 << 20, 'x');
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  CHECK(conn.try_send(big));
+  CHECK(elapsed_ms(start) < prompt_ms);
+  CHECK(conn.above_watermark());
+
+  DBus::SignalMessage small(object_path, interface_name, "Small");
+
+  start = chrono::steady_clock::now();
+  CHECK(!conn.try_send(small));
+  CHECK(elapsed_ms(start) < prompt_ms);
+
+  peer.release();
+  conn.disconnect();
+}
+
+static void *flush_connection(void *conn)
+{
+  static_cast<DBus::Connection *>(conn)->flush();
+  return NULL;
+}
+
+/* send() does not wait for the socket either, and a flush() waiting for a
+ * peer that reads nothing returns once the connection is closed under it
+ */
+static void flush_stalled()
+{
+  ScriptedPeer peer("stallflush", ScriptedPeer::Stall);
+  DBus::Connection &conn = kept(new DBus::Connection(peer.address.c_str(), true, DBus::Connection::Native));
+
+  DBus::SignalMessage big(object_path, interface_name, "Big");
+  DBus::MessageIter wi = big.writer();
+
+  wi << string(4 << 20, 'x');
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  CHECK(conn.send(big));
+  CHECK(elapsed_ms(start) < prompt_ms);
+
+  pthread_t flusher;
+
+  pthread_create(&flusher, NULL, flush_connection, &conn);
+  usleep(100000);
+
+  start = chrono::steady_clock::now();
+  conn.disconnect();
+  pthread_join(flusher, NULL);
+  CHECK(elapsed_ms(start) < prompt_ms);
+
+  peer.release();
+}
+
+static void peer_reply_routing()
+{
+  const string address = socket_address("echo");
+
+  servers.push_back(new EchoPeer(address.c_str()));
+
+  // the server authenticates the client from the dispatcher
+  start_dispatching();
+
+  DBus::Connection &conn = kept(new DBus::Connection(address.c_str(), true, DBus::Connection::Native));
+  NoiseCounter counter(conn);
+
+  concurrent_echo(conn, NULL);
+
+  DBus::CallMessage fail(NULL, object_path, interface_name, "Fail");
+  bool thrown = false;
+
+  try
+  {
+    conn.send_blocking(fail, 5000);
+  }
+  catch (DBus::Error &e)
+  {
+    thrown = !strcmp(e.name(), DBUS_ERROR_INVALID_ARGS);
+  }
+  CHECK(thrown);
+
+  // the signals sent ahead of each reply are dispatched all the same
+  for (int i = 0; i < 500 && counter.count < threads * calls * noise; ++i)
+    usleep(10000);
+  CHECK(counter.count == threads * calls * noise);
+
+  conn.disconnect();
+  unlink(address.c_str() + strlen("unix:path="));
+}
+
+static void session_reply_routing()
+{
+  DBus::Connection &native = kept(new DBus::Connection(DBus::Connection::SessionBus(DBus::Connection::Native)));
+  DBus::Connection &libdbus = kept(new DBus::Connection(DBus::Connection::SessionBus()));
+
+  DBus::Connection &other = kept(new DBus::Connection(DBus::Connection::SessionBus(DBus::Connection::Native)));
+
+  CHECK(native.unique_name() && native.unique_name()[0] == ':');
+
+  EchoAdaptor adaptor(native);
+  const string native_name = native.unique_name();
+
+  start_dispatching();
+
+  // calls into the native connection's object, from both transports
+  concurrent_echo(libdbus, native_name.c_str());
+  concurrent_echo(other, native_name.c_str());
+
+  DBus::CallMessage missing(native_name.c_str(), "/nowhere", interface_name, "Echo");
+  bool thrown = false;
+
+  try
+  {
+    other.send_blocking(missing, 5000);
+  }
+  catch (DBus::Error &e)
+  {
+    thrown = !strcmp(e.name(), DBUS_ERROR_UNKNOWN_METHOD);
+  }
+  CHECK(thrown);
+}
+
+int main(int argc, char **argv)
+{
+  const bool session = argc > 1 && !strcmp(argv[1], "session");
+
+  DBus::_init_threading();
+  DBus::default_dispatcher = &dispatcher;
+
+  try
+  {
+    if (session)
+    {
+      session_reply_routing();
+    }
+    else
+    {
+      auth_failure();
+      disconnect_during_send();
+      oversized_frame();
+      try_send_stalled(DBus::Connection::Native);
+      try_send_stalled(DBus::Connection::Libdbus);
+      flush_stalled();
+      peer_reply_routing();
+    }
+  }
+  catch (DBus::Error &e)
+  {
+    fprintf(stderr, "%s: %s\n", e.name(), e.message());
+    ++failures;
+  }
+
+  if (dispatching)
+  {
+    dispatcher.leave();
+    pthread_join(dispatch_thread, NULL);
+  }
+
+  for (list<DBus::Server *>::iterator s = servers.begin(); s != servers.end(); ++s)
+  {
+    (*s)->disconnect();
+    delete *s;
+  }
+  for (list<DBus::Connection *>::iterator c = connections.begin(); c != connections.end(); ++c)
+    delete *c;
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,572 @@
+// Round trips of the container, tuple and struct overloads, WireWriter and
+// SignaturePlan. Each value is written with MessageIter, the body is
+// marshalled again in little and in big endian order, and what libdbus
+// loads from that is read back with reader(), wire_reader() and
+// unchecked_reader(), all of which must return the value written. Bodies
+// written with WireWriter, and encoded again from what SignaturePlan
+// decoded, must read the same as those written with MessageIter.
+
+#include <dbus-c++/dbus.h>
+#include <dbus-c++/wire.h>
+#include <dbus-c++/struct.h>
+#include <dbus-c++/dynamic.h>
+
+#include <dbus/dbus.h>
+
+#include <bitset>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+struct Point
+{
+  int32_t x;
+  int32_t y;
+  string label;
+
+  bool operator == (const Point &p) const
+  {
+    return x == p.x && y == p.y && label == p.label;
+  }
+};
+
+DBUSXX_STRUCT(Point, x, y, label)
+
+static const char *const interface_name = "org.freedesktop.DBus.Test.RoundTrip";
+static const char *const object_path = "/org/freedesktop/DBus/Test/RoundTrip";
+static const char orders[] = { DBUS_LITTLE_ENDIAN, DBUS_BIG_ENDIAN, '\0' };
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); ++failures; } } while (0)
+
+static void check(bool ok, const char *what, const char *how, char order)
+{
+  if (ok)
+    return;
+
+  fprintf(stderr, "%s: %s read back something else, order '%c'\n", what, how, order);
+  ++failures;
+}
+
+static size_t alignment(int type)
+{
+  switch (type)
+  {
+  case DBUS_TYPE_BYTE:
+  case DBUS_TYPE_SIGNATURE:
+  case DBUS_TYPE_VARIANT:
+    return 1;
+  case DBUS_TYPE_INT16:
+  case DBUS_TYPE_UINT16:
+    return 2;
+  case DBUS_TYPE_INT64:
+  case DBUS_TYPE_UINT64:
+  case DBUS_TYPE_DOUBLE:
+  case DBUS_TYPE_STRUCT:
+  case DBUS_TYPE_DICT_ENTRY:
+    return 8;
+  default:
+    return 4;
+  }
+}
+
+/* writes the values the libdbus reader finds in the given byte order, as a
+ * peer of that order would send them
+ */
+struct Marshaller
+{
+  char order;
+  string data;
+
+  void pad(size_t n)
+  {
+    while (data.size() % n)
+      data += '\0';
+  }
+
+  void put(uint64_t v, size_t size)
+  {
+    pad(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+      const size_t shift = order == DBUS_BIG_ENDIAN ? size - 1 - i : i;
+      data += char(v >> (8 * shift));
+    }
+  }
+
+  void put_string(const char *s)
+  {
+    put(strlen(s), 4);
+    data.append(s, strlen(s) + 1);
+  }
+
+  void put_signature(const char *sig)
+  {
+    data += char(strlen(sig));
+    data.append(sig, strlen(sig) + 1);
+  }
+
+  void put_double(double d)
+  {
+    uint64_t v;
+
+    memcpy(&v, &d, sizeof(v));
+    put(v, 8);
+  }
+
+  /* the value at it, which is moved past it
+   */
+  void put_value(DBus::MessageIter &it)
+  {
+    const int type = it.type();
+
+    switch (type)
+    {
+    case DBUS_TYPE_BYTE:
+      put(it.get_byte(), 1);
+      break;
+    case DBUS_TYPE_BOOLEAN:
+      put(it.get_bool(), 4);
+      break;
+    case DBUS_TYPE_INT16:
+      put((uint16_t)it.get_int16(), 2);
+      break;
+    case DBUS_TYPE_UINT16:
+      put(it.get_uint16(), 2);
+      break;
+    case DBUS_TYPE_INT32:
+      put((uint32_t)it.get_int32(), 4);
+      break;
+    case DBUS_TYPE_UINT32:
+      put(it.get_uint32(), 4);
+      break;
+    case DBUS_TYPE_INT64:
+      put(it.get_int64(), 8);
+      break;
+    case DBUS_TYPE_UINT64:
+      put(it.get_uint64(), 8);
+      break;
+    case DBUS_TYPE_DOUBLE:
+      put_double(it.get_double());
+      break;
+    case DBUS_TYPE_STRING:
+      put_string(it.get_string());
+      break;
+    case DBUS_TYPE_OBJECT_PATH:
+      put_string(it.get_path());
+      break;
+    case DBUS_TYPE_SIGNATURE:
+      put_signature(it.get_signature());
+      break;
+    case DBUS_TYPE_ARRAY:
+    {
+      put(0, 4);
+      const size_t length_at = data.size() - 4;
+
+      pad(alignment(it.array_type()));
+      const size_t start = data.size();
+
+      for (DBus::MessageIter ait = it.recurse(); !ait.at_end(); )
+        put_value(ait);
+
+      Marshaller length = { order, string() };
+      length.put(data.size() - start, 4);
+      data.replace(length_at, 4, length.data);
+      break;
+    }
+    case DBUS_TYPE_VARIANT:
+    {
+      DBus::MessageIter vit = it.recurse();
+      char *sig = vit.signature();
+
+      put_signature(sig);
+      free(sig);
+      put_value(vit);
+      break;
+    }
+    case DBUS_TYPE_STRUCT:
+    case DBUS_TYPE_DICT_ENTRY:
+      pad(8);
+      for (DBus::MessageIter sit = it.recurse(); !sit.at_end(); )
+        put_value(sit);
+      break;
+    default:
+      fprintf(stderr, "unexpected type '%c'\n", type);
+      exit(1);
+    }
+    ++it;
+  }
+};
+
+static string body_signature(const DBus::Message &msg)
+{
+  string sig;
+
+  for (DBus::MessageIter it = msg.reader(); !it.at_end(); ++it)
+  {
+    char *s = it.signature();
+
+    sig += s;
+    free(s);
+  }
+  return sig;
+}
+
+/* the body of msg in a method return marshalled in the given order
+ */
+static string marshal(const DBus::Message &msg, char order)
+{
+  Marshaller body = { order, string() };
+
+  for (DBus::MessageIter it = msg.reader(); !it.at_end(); )
+    body.put_value(it);
+
+  const string sig = body_signature(msg);
+  Marshaller m = { order, string() };
+
+  m.data += order;
+  m.data += char(DBUS_MESSAGE_TYPE_METHOD_RETURN);
+  m.data += '\0';
+  m.data += char(DBUS_MAJOR_PROTOCOL_VERSION);
+  m.put(body.data.size(), 4);
+  m.put(1, 4);                  // serial
+  m.put(0, 4);                  // header fields length, patched below
+
+  m.pad(8);
+  m.data += char(DBUS_HEADER_FIELD_REPLY_SERIAL);
+  m.put_signature("u");
+  m.put(1, 4);
+  m.pad(8);
+  m.data += char(DBUS_HEADER_FIELD_SIGNATURE);
+  m.put_signature("g");
+  m.put_signature(sig.c_str());
+
+  Marshaller fields = { order, string() };
+  fields.put(m.data.size() - 16, 4);
+  m.data.replace(12, 4, fields.data);
+  m.pad(8);
+
+  return m.data + body.data;
+}
+
+static DBus::Message load(const string &data)
+{
+  return DBus::Message::demarshal(data.data(), data.size());
+}
+
+template <typename T>
+static bool read_back(DBus::MessageIter it, const T &val)
+{
+  T out;
+
+  it >> out;
+  return out == val && it.at_end();
+}
+
+/* val written with MessageIter and read back by each reader, from either
+ * byte order
+ */
+template <typename T>
+static void round_trip(const char *what, const T &val)
+{
+  DBus::SignalMessage src(object_path, interface_name, "RoundTrip");
+  DBus::MessageIter wi = src.writer();
+
+  wi << val;
+
+  const DBus::sig_cstr< DBus::type<T> > sig;
+
+  CHECK(body_signature(src) == sig.c_str());
+
+  for (const char *order = orders; *order; ++order)
+  {
+    const DBus::Message m = load(marshal(src, *order));
+
+    check(read_back(m.reader(), val), what, "reader()", *order);
+    check(read_back(m.wire_reader(), val), what, "wire_reader()", *order);
+    check(read_back(m.unchecked_reader(sig.c_str()), val), what, "unchecked_reader()", *order);
+  }
+}
+
+/* val written with WireWriter reads the same as written with MessageIter
+ */
+template <typename T>
+static void wire_round_trip(const char *what, const T &val)
+{
+  DBus::SignalMessage src(object_path, interface_name, "RoundTrip");
+  DBus::MessageIter wi = src.writer();
+
+  wi << val;
+
+  DBus::WireWriter w;
+
+  w << val;
+
+  const DBus::Message m = w.message(src);
+
+  check(marshal(m, DBUS_LITTLE_ENDIAN) == marshal(src, DBUS_LITTLE_ENDIAN), what, "WireWriter", 'l');
+  check(read_back(m.reader(), val), what, "WireWriter, reader()", 'l');
+  check(read_back(m.wire_reader(), val), what, "WireWriter, wire_reader()", 'l');
+}
+
+template <typename T>
+static void both_round_trips(const char *what, const T &val)
+{
+  round_trip(what, val);
+  wire_round_trip(what, val);
+}
+
+static void containers()
+{
+  unordered_map<string, int32_t> names;
+  unordered_map<uint32_t, vector<string> > lists;
+
+  for (int i = 0; i < 50; ++i)
+  {
+    names["name " + to_string(i)] = i * i;
+    lists[i * 7].assign(i % 4, string(i, 'z'));
+  }
+  both_round_trips("unordered_map<string, int32_t>", names);
+  both_round_trips("unordered_map<uint32_t, vector<string>>", lists);
+  both_round_trips("empty unordered_map", unordered_map<string, string>());
+
+  array<double, 4> doubles = {{ 1.5, -2.25, 0, 1e300 }};
+  array<string, 3> strings = {{ "a", "", "ccc" }};
+  array<uint8_t, 0> none;
+  both_round_trips("array<double, 4>", doubles);
+  both_round_trips("array<string, 3>", strings);
+  both_round_trips("array<uint8_t, 0>", none);
+
+  set<string> words = { "one", "two", "three" };
+  set<int32_t> numbers = { -5, 0, 5, 1 << 30 };
+  both_round_trips("set<string>", words);
+  both_round_trips("set<int32_t>", numbers);
+
+  deque<int64_t> longs;
+  deque<string> lines;
+  list<string> items = { "x", "yy", "" };
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    longs.push_back(int64_t(i) << 40);
+    if (i % 10 == 0)
+      lines.push_back(string(i, 'l'));
+  }
+  both_round_trips("deque<int64_t>", longs);
+  both_round_trips("deque<string>", lines);
+  both_round_trips("list<string>", items);
+  both_round_trips("list<uint16_t>", list<uint16_t>(33, 0xbeef));
+
+  both_round_trips("pair<string, uint32_t>", make_pair(string("key"), 0xdeadbeefu));
+  both_round_trips("vector<pair<int16_t, double>>", vector<pair<int16_t, double> >(5, make_pair(int16_t(-3), 0.5)));
+
+  vector<bool> flags;
+  bitset<100> bits;
+
+  for (int i = 0; i < 300; ++i)
+    flags.push_back(i % 3 == 0);
+  for (int i = 0; i < 100; i += 7)
+    bits.set(i);
+  both_round_trips("vector<bool>", flags);
+  both_round_trips("bitset<100>", bits);
+
+  map<string, vector<Point> > nested;
+
+  nested["origin"].push_back(Point());
+  nested["corners"].push_back(Point { -1, 1, "top left" });
+  nested["corners"].push_back(Point { 1, -1, "bottom right" });
+  both_round_trips("map<string, vector<Point>>", nested);
+}
+
+static void tuples()
+{
+  tuple<uint8_t, int16_t, uint64_t, string, vector<string> > t(7, -300, 1ull << 63, "tuple", vector<string>(3, "s"));
+
+  both_round_trips("tuple<y, n, t, s, as>", t);
+  both_round_trips("tuple<double>", make_tuple(3.25));
+  both_round_trips("vector<tuple<string, int32_t>>", vector<tuple<string, int32_t> >(4, make_tuple(string("e"), 4)));
+}
+
+static void structs()
+{
+  Point p = { 3, -4, "point" };
+  vector<Point> points;
+
+  for (int i = 0; i < 20; ++i)
+    points.push_back(Point { i, -i, string(i, 'p') });
+
+  both_round_trips("Point", p);
+  both_round_trips("vector<Point>", points);
+  both_round_trips("pair<Point, Point>", make_pair(p, p));
+}
+
+/* the count each reader gives for an array of n elements
+ */
+template <typename T>
+static void element_count(const char *what, const T &val, int n)
+{
+  DBus::SignalMessage src(object_path, interface_name, "RoundTrip");
+  DBus::MessageIter wi = src.writer();
+
+  wi << val;
+
+  for (const char *order = orders; *order; ++order)
+  {
+    const DBus::Message m = load(marshal(src, *order));
+
+    check(m.reader().element_count() == n, what, "reader() element_count()", *order);
+    check(m.wire_reader().element_count() == n, what, "wire_reader() element_count()", *order);
+  }
+}
+
+static void element_counts()
+{
+  map<string, int32_t> dict;
+
+  for (int i = 0; i < 5; ++i)
+    dict[to_string(i)] = i;
+
+  element_count("vector<int32_t>", vector<int32_t>(1000, 1), 1000);
+  element_count("vector<uint8_t>", vector<uint8_t>(3, 1), 3);
+  element_count("vector<string>", vector<string>(37, "s"), 37);
+  element_count("map<string, int32_t>", dict, 5);
+  element_count("empty vector<double>", vector<double>(), 0);
+}
+
+#ifdef DBUSXX_HAS_PMR
+
+static void pmr_containers()
+{
+  std::pmr::monotonic_buffer_resource pool;
+  std::pmr::vector<std::pmr::string> strings(&pool);
+  std::pmr::map<std::pmr::string, std::pmr::vector<int32_t> > dict(&pool);
+
+  for (int i = 0; i < 40; ++i)
+  {
+    strings.emplace_back(string(i, 'm'));
+    dict[std::pmr::string(to_string(i))].assign(i, i);
+  }
+  round_trip("pmr::vector<pmr::string>", strings);
+  round_trip("pmr::map<pmr::string, pmr::vector<int32_t>>", dict);
+
+  DBus::SignalMessage src(object_path, interface_name, "RoundTrip");
+  DBus::MessageIter wi = src.writer();
+
+  wi << strings;
+
+  for (const char *order = orders; *order; ++order)
+  {
+    const DBus::Message m = load(marshal(src, *order));
+    std::pmr::monotonic_buffer_resource into;
+    std::pmr::vector<std::pmr::string> out(&into);
+    DBus::MessageIter ri = m.wire_reader();
+
+    ri >> out;
+    check(out == strings, "pmr::vector<pmr::string>", "wire_reader() into a resource", *order);
+    CHECK(out.back().get_allocator().resource() == &into);
+  }
+}
+
+#endif
+
+/* decoded by SignaturePlan and encoded again, through WireWriter and
+ * through MessageIter, the body of src reads the same as before
+ */
+static void plan_round_trip(const char *what, const DBus::Message &src)
+{
+  const string sig = body_signature(src);
+  const string expected = marshal(src, DBUS_LITTLE_ENDIAN);
+  unique_ptr<DBus::SignaturePlan> once;
+  const DBus::SignaturePlan &plan = DBus::SignaturePlan::get(sig.c_str(), once);
+
+  for (const char *order = orders; *order; ++order)
+  {
+    const DBus::Message m = load(marshal(src, *order));
+    DBus::ValueArena arena;
+    const DBus::DynamicValue *values = plan.decode(m, arena);
+
+    DBus::WireWriter w;
+
+    plan.encode(values, w);
+    check(marshal(w.message(src), DBUS_LITTLE_ENDIAN) == expected, what, "SignaturePlan to WireWriter", *order);
+
+    DBus::SignalMessage out(object_path, interface_name, "RoundTrip");
+    DBus::MessageIter wi = out.writer();
+
+    plan.encode(values, wi);
+    check(marshal(out, DBUS_LITTLE_ENDIAN) == expected, what, "SignaturePlan to MessageIter", *order);
+
+    DBus::MessageIter it = m.reader();
+    const DBus::DynamicValue *read = plan.decode(it, arena);
+
+    DBus::WireWriter again;
+
+    plan.encode(read, again);
+    check(marshal(again.message(src), DBUS_LITTLE_ENDIAN) == expected, what, "SignaturePlan from reader()", *order);
+  }
+}
+
+static void plans()
+{
+  DBus::SignalMessage src(object_path, interface_name, "RoundTrip");
+  DBus::MessageIter wi = src.writer();
+  map<string, DBus::Variant> props;
+  DBus::Variant number;
+  DBus::Variant names;
+
+  DBus::MessageIter ni = number.writer();
+  DBus::MessageIter si = names.writer();
+
+  ni << int64_t(-42);
+  si << vector<string>(3, "name");
+  props["number"] = number;
+  props["names"] = names;
+
+  wi << string("plan") << vector<double>(100, 0.25) << props;
+  wi << make_tuple(uint8_t(1), true, DBus::Path("/a/b"), DBus::Signature("a{sv}"));
+  wi << vector<Point>(3, Point { 1, 2, "three" }) << vector<bool>(70, true);
+
+  plan_round_trip("mixed body", src);
+
+  DBus::SignalMessage empty(object_path, interface_name, "RoundTrip");
+  DBus::MessageIter ei = empty.writer();
+
+  ei << vector<string>() << map<uint16_t, vector<int32_t> >() << string();
+  plan_round_trip("empty containers", empty);
+}
+
+int main()
+{
+  try
+  {
+    containers();
+    tuples();
+    structs();
+    element_counts();
+#ifdef DBUSXX_HAS_PMR
+    pmr_containers();
+#endif
+    plans();
+  }
+  catch (DBus::Error &e)
+  {
+    fprintf(stderr, "%s: %s\n", e.name(), e.message());
+    ++failures;
+  }
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+#ifndef DBUSCXX_TEST_GENERATOR_TYPES_H
+#define DBUSCXX_TEST_GENERATOR_TYPES_H
+
+#include <dbus-c++/dbus.h>
+
+namespace Test
+{
+
+struct Record
+{
+  int32_t id;
+  std::string name;
+  bool enabled;
+};
+
+} /* namespace Test */
+
+DBUSXX_STRUCT(Test::Record, id, name, enabled)
+
+#endif // DBUSCXX_TEST_GENERATOR_TYPES_H
@@ -36,6 +36,29 @@ extern const char *tab;
 extern const char *header;
 extern const char *dbus_includes;
 
+/*! Type used for an 'in' argument. Arguments annotated with
+ *  org.freedesktop.DBus.Borrow="true" are passed as views into the call
+ *  message instead of being copied, if their signature allows it.
+ */
+static string in_arg_type(Xml::Node &arg)
+{
+  Xml::Nodes annotations = arg["annotation"];
+  Xml::Nodes annotations_borrow = annotations.select("name", "org.freedesktop.DBus.Borrow");
+
+  if (!annotations_borrow.empty() && annotations_borrow.front()->get("value") == "true")
+  {
+    string view_type = signature_to_view_type(arg.get("type"));
+
+    if (!view_type.empty())
+      return view_type;
+
+    cerr << "Argument: " << arg.get("name") << ":" << endl;
+    cerr << "Option 'org.freedesktop.DBus.Borrow' not supported for type '" << arg.get("type") << "'!" << endl << "-> Option ignored!" << endl;
+  }
+
+  return arg_type(arg);
+}
+
 /*! Generate adaptor code for a XML introspection
   */
 void generate_adaptor(Xml::Document &doc, const char *filename)
@@ -285,7 +308,7 @@ void generate_adaptor(Xml::Document &doc, const char *filename)
         if (!arg_object.empty())
           body << arg_object << " ";
         else
-          body << signature_to_type(args_out.front()->get("type")) << " ";
+          body << arg_type(*args_out.front()) << " ";
       }
 
       // generate the method name
@@ -306,7 +329,7 @@ void generate_adaptor(Xml::Document &doc, const char *filename)
 
         // generate basic signature only if no object name available...
         if (!arg_object.length())
-          body << "const " << signature_to_type(arg.get("type")) << "& ";
+          body << "const " << in_arg_type(arg) << "& ";
         // ...or generate object style if available
         else {
           body << "const " << arg_object << "& ";
@@ -338,7 +361,7 @@ void generate_adaptor(Xml::Document &doc, const char *filename)
 
           // generate basic signature only if no object name available...
           if (!arg_object.length())
-            body << signature_to_type(arg.get("type")) << "& ";
+            body << arg_type(arg) << "& ";
           // ...or generate object style if available
           else {
             body << arg_object << "& ";
@@ -385,7 +408,7 @@ void generate_adaptor(Xml::Document &doc, const char *filename)
 
         // generate basic signature only if no object name available...
         if (arg_object.empty())
-          body << "const " << signature_to_type(arg.get("type")) << "& arg" << i + 1;
+          body << "const " << arg_type(arg) << "& arg" << i + 1;
         // ...or generate object style if available
         else {
           body << "const " << arg_object << "& arg" << i + 1;
@@ -418,7 +441,7 @@ void generate_adaptor(Xml::Document &doc, const char *filename)
             arg_object = annotations_object.front()->get("value");
 
           if (arg_object.length()) {
-            body << tab << tab << signature_to_type(arg.get("type")) << " _arg" << i + 1 << ";" << endl;
+            body << tab << tab << arg_type(arg) << " _arg" << i + 1 << ";" << endl;
             body << tab << tab << "_arg" << i + 1 << " << " << "arg" << i + 1 << ";" << endl;
 
             body << tab << tab << "wi << _arg" << i + 1 << ";" << endl;
@@ -449,7 +472,7 @@ void generate_adaptor(Xml::Document &doc, const char *filename)
       body << tab << "::DBus::Message " << stub_name(method.get("name")) << "(const ::DBus::CallMessage &call)" << endl
            << tab << "{" << endl;
       if(!args_in.empty()) {
-         body << tab << tab << "::DBus::MessageIter ri = call.reader();" << endl;
+         body << tab << tab << "::DBus::MessageIter ri = call.unchecked_reader(\"" << args_signature(args_in) << "\");" << endl;
          body << endl;
       }
 
@@ -459,7 +482,14 @@ void generate_adaptor(Xml::Document &doc, const char *filename)
       {
         Xml::Node &arg = **ai;
 
-        body << tab << tab << signature_to_type(arg.get("type")) << " argin" << i << "; ";
+        Xml::Nodes annotations = arg["annotation"];
+        Xml::Nodes annotations_object = annotations.select("name", "org.freedesktop.DBus.Object");
+
+        // object arguments are converted from a copy, never from a borrowed view
+        string type = annotations_object.empty() ? in_arg_type(arg) : arg_type(arg);
+
+        body << tab << tab << arg_check(type, arg) << endl;
+        body << tab << tab << type << " argin" << i << "; ";
         body << "ri >> argin" << i << ";" << endl;
       }
 
@@ -488,7 +518,7 @@ void generate_adaptor(Xml::Document &doc, const char *filename)
         {
           Xml::Node &arg = **ao;
 
-          body << tab << tab << signature_to_type(arg.get("type")) << " argout" << i;
+          body << tab << tab << arg_type(arg) << " argout" << i;
 
           if (args_out.size() == 1) // a single 'out' parameter will be assigned
             body << " = ";
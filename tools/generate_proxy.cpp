@@ -143,7 +143,7 @@ void generate_proxy(Xml::Document &doc, const char *filename)
       string property_access = property.get("access");
       if (property_access == "read" || property_access == "readwrite")
       {
-        body << tab << tab << "const " << signature_to_type(property.get("type"))
+        body << tab << tab << signature_to_type(property.get("type"))
              << " " << prop_name << "() {" << endl;
         body << tab << tab << tab << "::DBus::CallMessage call ;\n ";
         body << tab << tab << tab
@@ -176,9 +176,7 @@ void generate_proxy(Xml::Document &doc, const char *filename)
         body << tab << tab << tab << "::DBus::CallMessage call ;\n ";
         body << tab << tab << tab << "call.member(\"Set\");  call.interface( \"org.freedesktop.DBus.Properties\");" << endl;
         body << tab << tab << tab << "::DBus::MessageIter wi = call.writer(); " << endl;
-        body << tab << tab << tab << "::DBus::Variant value;" << endl;
-        body << tab << tab << tab << "::DBus::MessageIter vi = value.writer ();" << endl;
-        body << tab << tab << tab << "vi << input;" << endl;
+        body << tab << tab << tab << "::DBus::Variant value(input);" << endl;
         body << tab << tab << tab << "const std::string interface_name = \"" << ifacename << "\";" << endl;
         body << tab << tab << tab << "const std::string property_name  = \"" << prop_name << "\";" << endl;
         body << tab << tab << tab << "wi << interface_name;" << endl;
@@ -239,7 +237,7 @@ void generate_proxy(Xml::Document &doc, const char *filename)
         }
         else
         {
-          body << tab << signature_to_type(args_out.front()->get("type")) << " ";
+          body << tab << arg_type(*args_out.front()) << " ";
         }
       }
 
@@ -262,7 +260,7 @@ void generate_proxy(Xml::Document &doc, const char *filename)
         // generate basic signature only if no object name available...
         if (!arg_object.length())
         {
-          body << "const " << signature_to_type(arg.get("type")) << "& ";
+          body << "const " << arg_type(arg) << "& ";
         }
         // ...or generate object style if available
         else
@@ -302,7 +300,7 @@ void generate_proxy(Xml::Document &doc, const char *filename)
           // generate basic signature only if no object name available...
           if (!arg_object.length())
           {
-            body << signature_to_type(arg.get("type")) << "&";
+            body << arg_type(arg) << "&";
           }
           // ...or generate object style if available
           else
@@ -358,7 +356,7 @@ void generate_proxy(Xml::Document &doc, const char *filename)
         // generate extra code to wrap object
         if (arg_object.length())
         {
-          body << tab << tab << signature_to_type(arg.get("type")) << "_" << arg_name << ";" << endl;
+          body << tab << tab << arg_type(arg) << "_" << arg_name << ";" << endl;
           body << tab << tab << "_" << arg_name << " << " << arg_name << ";" << endl;
 
           arg_name = string("_") + arg_name;
@@ -391,7 +389,7 @@ void generate_proxy(Xml::Document &doc, const char *filename)
 
       if (!args_out.empty())
       {
-        body << tab << tab << "::DBus::MessageIter ri = ret.reader();" << endl
+        body << tab << tab << "::DBus::MessageIter ri = ret.unchecked_reader(\"" << args_signature(args_out) << "\");" << endl
              << endl;
       }
 
@@ -412,7 +410,8 @@ void generate_proxy(Xml::Document &doc, const char *filename)
           body << tab << tab << arg_object << " _argout;" << endl;
         }
 
-        body << tab << tab << signature_to_type(args_out.front()->get("type")) << " argout;" << endl;
+        body << tab << tab << arg_check(arg_type(*args_out.front()), *args_out.front()) << endl;
+        body << tab << tab << arg_type(*args_out.front()) << " argout;" << endl;
 
         body << tab << tab << "ri >> argout;" << endl;
 
@@ -450,9 +449,11 @@ void generate_proxy(Xml::Document &doc, const char *filename)
 
           if (arg_object.length())
           {
-            body << tab << tab << signature_to_type(arg.get("type")) << "_" << arg_name << ";" << endl;
+            body << tab << tab << arg_type(arg) << "_" << arg_name << ";" << endl;
           }
 
+          body << tab << tab << arg_check(arg_type(arg), arg) << endl;
+
           if (arg_object.length())
           {
             body << tab << tab << "ri >> " << "_" << arg_name << ";" << endl;
@@ -506,7 +507,7 @@ void generate_proxy(Xml::Document &doc, const char *filename)
         // generate basic signature only if no object name available...
         if (!arg_object.length())
         {
-          body << "const " << signature_to_type(arg.get("type")) << "& ";
+          body << "const " << arg_type(arg) << "& ";
         }
         // ...or generate object style if available
         else
@@ -546,7 +547,7 @@ void generate_proxy(Xml::Document &doc, const char *filename)
 
       if (!args.empty())
       {
-        body << tab << tab << "::DBus::MessageIter ri = sig.reader();" << endl
+        body << tab << tab << "::DBus::MessageIter ri = sig.unchecked_reader(\"" << args_signature(args) << "\");" << endl
              << endl;
       }
 
@@ -564,7 +565,8 @@ void generate_proxy(Xml::Document &doc, const char *filename)
           arg_object = annotations_object.front()->get("value");
         }
 
-        body << tab << tab << signature_to_type(arg.get("type")) << " " ;
+        body << tab << tab << arg_check(arg_type(arg), arg) << endl;
+        body << tab << tab << arg_type(arg) << " " ;
 
         // use a default if no arg name given
         if (!arg_name.length())
@@ -95,7 +95,7 @@ static void _parse_signature(const string &signature, string &type, unsigned int
         type += " >";
         break;
       case '(':
-        type += "std::vector< ::DBus::Struct< ";
+        type += "std::vector< std::tuple< ";
         _parse_signature(signature, type, ++i);
         type += " > >";
         break;
@@ -107,7 +107,7 @@ static void _parse_signature(const string &signature, string &type, unsigned int
       }
       break;
     case '(':
-      type += "::DBus::Struct< ";
+      type += "std::tuple< ";
       _parse_signature(signature, type, ++i);
       type += " >";
       break;
@@ -145,3 +145,83 @@ string signature_to_type(const string &signature)
   _parse_signature(signature, type, i);
   return type;
 }
+
+/*! Borrowed view type for a signature (see DBus::StringView and DBus::ArrayView),
+ *  or an empty string if the signature has no view representation.
+ */
+string signature_to_view_type(const string &signature)
+{
+  if (signature == "s")
+    return "::DBus::StringView";
+
+  if (signature == "as")
+    return "std::vector< ::DBus::StringView >";
+
+  if (signature.length() == 2 && signature[0] == 'a')
+  {
+    switch (signature[1])
+    {
+    case 'y':
+    case 'n':
+    case 'q':
+    case 'i':
+    case 'u':
+    case 'x':
+    case 't':
+    case 'd':
+      return string("::DBus::ArrayView< ") + atomic_type_to_string(signature[1]) + " >";
+    }
+  }
+
+  return "";
+}
+
+/*! C++ type of a method or signal argument. Struct arguments annotated with
+ *  org.freedesktop.DBus.Struct="ns::Type" use that type, which must be
+ *  declared with DBUSXX_STRUCT; arrays of structs become vectors of it.
+ */
+string arg_type(DBus::Xml::Node &arg)
+{
+  string signature = arg.get("type");
+  DBus::Xml::Nodes annotations = arg["annotation"];
+  DBus::Xml::Nodes annotations_struct = annotations.select("name", "org.freedesktop.DBus.Struct");
+
+  if (!annotations_struct.empty())
+  {
+    string struct_type = annotations_struct.front()->get("value");
+
+    if (signature[0] == '(')
+      return struct_type;
+
+    if (signature.compare(0, 2, "a(") == 0)
+      return "std::vector< " + struct_type + " >";
+
+    cerr << "Argument: " << arg.get("name") << ":" << endl;
+    cerr << "Option 'org.freedesktop.DBus.Struct' not supported for type '" << signature << "'!" << endl << "-> Option ignored!" << endl;
+  }
+
+  return signature_to_type(signature);
+}
+
+/*! Body signature of a message carrying \a args, in order.
+ */
+string args_signature(DBus::Xml::Nodes &args)
+{
+  string signature;
+
+  for (DBus::Xml::Nodes::iterator ai = args.begin(); ai != args.end(); ++ai)
+    signature += (*ai)->get("type");
+
+  return signature;
+}
+
+/*! Compile-time check that \a type reads the signature of \a arg; emitted next
+ *  to every argument unmarshalled through Message::unchecked_reader().
+ */
+string arg_check(const string &type, DBus::Xml::Node &arg)
+{
+  string signature = arg.get("type");
+
+  return "static_assert(::DBus::sig_matches< " + type + " >(\"" + signature + "\"), "
+         "\"argument type does not match signature " + signature + "\");";
+}
@@ -28,9 +28,15 @@
 #include <sstream>
 #include <iomanip>
 
+#include "xml.h"
+
 const char *atomic_type_to_string(char t);
 std::string stub_name(std::string name);
 std::string signature_to_type(const std::string &signature);
+std::string signature_to_view_type(const std::string &signature);
+std::string arg_type(DBus::Xml::Node &arg);
+std::string args_signature(DBus::Xml::Nodes &args);
+std::string arg_check(const std::string &type, DBus::Xml::Node &arg);
 void underscorize(std::string &str);
 
 /// create std::string from any number